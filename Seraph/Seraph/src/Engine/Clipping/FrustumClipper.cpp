@@ -0,0 +1,650 @@
+#include "FrustumClipper.h"
+#include "CommonIncludes.h"
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+// SSE2 is part of every x86-64 cpu, so it needs no check at runtime. Other cpus use the plain loop.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERAPH_CLIP_SSE
+#include <emmintrin.h>
+#endif
+
+int frustumSidePlanes(float scaleX, float scaleY, ClipPlane* planes) {
+	// a point is outside of a side when x * scaleX is further from the middle than z (the same test clipVertices makes).
+	planes[0] = { scaleX, 0, 1, 0 };
+	planes[1] = { 0, scaleY, 1, 0 };
+	planes[2] = { -scaleX, 0, 1, 0 };
+	planes[3] = { 0, -scaleY, 1, 0 };
+	return 4;
+}
+
+int frustumPlanes(float scaleX, float scaleY, float zNear, float zFar, ClipPlane* planes) {
+	// near goes first, as behind the camera the side planes cross over and a triangle there is outside of them too.
+	planes[0] = { 0, 0, 1, -zNear };
+	planes[1] = { 0, 0, -1, zFar };
+	return 2 + frustumSidePlanes(scaleX, scaleY, planes + 2);
+}
+
+BoundsClip classifyBounds(const Vec3& boundsMin, const Vec3& boundsMax, const Vec3& boundsCenter, float boundsRadius, const Mat4& transform, const ClipPlane* planes, int planeCount) {
+	// the radius grows with the largest scale in the transform (the length of its longest axis).
+	float scale = 0;
+	for (int column = 0; column < 3; column++) {
+		Vec3 axis = { transform.m[column], transform.m[4 + column], transform.m[8 + column] };
+		scale = std::max(scale, axis.abs());
+	}
+	Vec3 center = transform.transformPoint(boundsCenter);
+	float radius = boundsRadius * scale;
+
+	bool sphereCrosses = false;
+	for (int plane = 0; plane < planeCount; plane++) {
+		// the planes are not of unit length, so the distance is scaled by the length of their normal.
+		float distance = planes[plane].distance(center) / sqrtf(planes[plane].a * planes[plane].a + planes[plane].b * planes[plane].b + planes[plane].c * planes[plane].c);
+		if (distance < -radius) {
+			return boundsOutside;
+		}
+		if (distance < radius) {
+			sphereCrosses = true;
+		}
+	}
+	if (!sphereCrosses) {
+		return boundsInside;
+	}
+
+	uint8_t outsideAll = 0xFF;
+	uint8_t outsideAny = 0;
+	for (int corner = 0; corner < 8; corner++) {
+		Vec3 point = { corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y, corner & 4 ? boundsMax.z : boundsMin.z };
+		point = transform.transformPoint(point);
+		uint8_t code = 0;
+		for (int plane = 0; plane < planeCount; plane++) {
+			if (planes[plane].distance(point) < 0) {
+				code |= 1 << plane;
+			}
+		}
+		outsideAll &= code;
+		outsideAny |= code;
+	}
+
+	if (outsideAll) {
+		return boundsOutside;
+	}
+	return 0 == outsideAny ? boundsInside : boundsCrossing;
+}
+
+// the first plane whose bit is set.
+static int firstPlane(uint8_t planeMask) {
+	int plane = 0;
+	while (0 == (planeMask & (1 << plane))) {
+		plane++;
+	}
+	return plane;
+}
+
+// sets a bit in the outcode of every vertex for each plane it is outside of, returns the outcodes of all vertices or'ed together.
+static uint8_t computeOutcodes(const Vertex* verts, size_t vertexCount, const ClipPlane* planes, int planeCount, uint8_t* outcodes) {
+	size_t index = 0;
+	uint8_t allCodes = 0;
+
+#ifdef SERAPH_CLIP_SSE
+	__m128 planeA[maxClipPlanes], planeB[maxClipPlanes], planeC[maxClipPlanes], planeD[maxClipPlanes];
+	__m128i planeBit[maxClipPlanes];
+	for (int plane = 0; plane < planeCount; plane++) {
+		planeA[plane] = _mm_set1_ps(planes[plane].a);
+		planeB[plane] = _mm_set1_ps(planes[plane].b);
+		planeC[plane] = _mm_set1_ps(planes[plane].c);
+		planeD[plane] = _mm_set1_ps(planes[plane].d);
+		planeBit[plane] = _mm_set1_epi32(1 << plane);
+	}
+
+	__m128 zero = _mm_setzero_ps();
+	__m128i anyCodes = _mm_setzero_si128();
+	for (; index + 4 <= vertexCount; index += 4) {
+		// the vertices are 28 bytes apart, so their positions are gathered into a register per axis.
+		const Vertex* vertex = verts + index;
+		__m128 x = _mm_setr_ps(vertex[0].pos.x, vertex[1].pos.x, vertex[2].pos.x, vertex[3].pos.x);
+		__m128 y = _mm_setr_ps(vertex[0].pos.y, vertex[1].pos.y, vertex[2].pos.y, vertex[3].pos.y);
+		__m128 z = _mm_setr_ps(vertex[0].pos.z, vertex[1].pos.z, vertex[2].pos.z, vertex[3].pos.z);
+
+		__m128i codes = _mm_setzero_si128();
+		for (int plane = 0; plane < planeCount; plane++) {
+			// added up in the same order as ClipPlane::distance, so a vertex on a plane is put on the same side as the clipping does.
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[plane], x), _mm_mul_ps(planeB[plane], y)), _mm_mul_ps(planeC[plane], z)), planeD[plane]);
+			__m128i outside = _mm_castps_si128(_mm_cmplt_ps(distance, zero));
+			codes = _mm_or_si128(codes, _mm_and_si128(outside, planeBit[plane]));
+		}
+		anyCodes = _mm_or_si128(anyCodes, codes);
+
+		// the four codes fit in a byte each.
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(codes, codes), codes);
+		uint32_t fourCodes = (uint32_t)_mm_cvtsi128_si32(packed);
+		memcpy(outcodes + index, &fourCodes, sizeof(fourCodes));
+	}
+
+	uint32_t anyCodeLanes[4];
+	_mm_storeu_si128((__m128i*)anyCodeLanes, anyCodes);
+	allCodes = (uint8_t)(anyCodeLanes[0] | anyCodeLanes[1] | anyCodeLanes[2] | anyCodeLanes[3]);
+#endif
+
+	for (; index < vertexCount; index++) {
+		uint8_t code = 0;
+		for (int plane = 0; plane < planeCount; plane++) {
+			if (planes[plane].distance(verts[index].pos) < 0) {
+				code |= 1 << plane;
+			}
+		}
+		outcodes[index] = code;
+		allCodes |= code;
+	}
+
+	return allCodes;
+}
+
+// dot(v1, cross(v2 - v1, v3 - v1)), the same for any corner of the triangle, and above 0 when the camera sees its front.
+static float facing(const Vec3& v1, const Vec3& v2, const Vec3& v3) {
+	float e1x = v2.x - v1.x, e1y = v2.y - v1.y, e1z = v2.z - v1.z;
+	float e2x = v3.x - v1.x, e2y = v3.y - v1.y, e2z = v3.z - v1.z;
+	return v1.x * (e1y * e2z - e1z * e2y) + v1.y * (e1z * e2x - e1x * e2z) + v1.z * (e1x * e2y - e1y * e2x);
+}
+
+uint32_t cullBackFaces(const std::vector<Vertex>& verts, std::vector<uint32_t>& indices, size_t firstIndex) {
+	size_t index = firstIndex;
+	size_t kept = firstIndex; // the kept triangles are moved down over the dropped ones, which never overtakes index.
+	size_t endIndex = firstIndex + (indices.size() - firstIndex) / 3 * 3;
+	uint32_t* data = indices.data();
+
+#ifdef SERAPH_CLIP_SSE
+	__m128 zero = _mm_setzero_ps();
+	for (; index + 12 <= endIndex; index += 12) {
+		// the corners of 4 triangles, gathered into a register per corner and axis.
+		const uint32_t* triangle = data + index;
+		const Vec3& a0 = verts[triangle[0]].pos; const Vec3& b0 = verts[triangle[1]].pos; const Vec3& c0 = verts[triangle[2]].pos;
+		const Vec3& a1 = verts[triangle[3]].pos; const Vec3& b1 = verts[triangle[4]].pos; const Vec3& c1 = verts[triangle[5]].pos;
+		const Vec3& a2 = verts[triangle[6]].pos; const Vec3& b2 = verts[triangle[7]].pos; const Vec3& c2 = verts[triangle[8]].pos;
+		const Vec3& a3 = verts[triangle[9]].pos; const Vec3& b3 = verts[triangle[10]].pos; const Vec3& c3 = verts[triangle[11]].pos;
+
+		__m128 ax = _mm_setr_ps(a0.x, a1.x, a2.x, a3.x);
+		__m128 ay = _mm_setr_ps(a0.y, a1.y, a2.y, a3.y);
+		__m128 az = _mm_setr_ps(a0.z, a1.z, a2.z, a3.z);
+		__m128 e1x = _mm_sub_ps(_mm_setr_ps(b0.x, b1.x, b2.x, b3.x), ax);
+		__m128 e1y = _mm_sub_ps(_mm_setr_ps(b0.y, b1.y, b2.y, b3.y), ay);
+		__m128 e1z = _mm_sub_ps(_mm_setr_ps(b0.z, b1.z, b2.z, b3.z), az);
+		__m128 e2x = _mm_sub_ps(_mm_setr_ps(c0.x, c1.x, c2.x, c3.x), ax);
+		__m128 e2y = _mm_sub_ps(_mm_setr_ps(c0.y, c1.y, c2.y, c3.y), ay);
+		__m128 e2z = _mm_sub_ps(_mm_setr_ps(c0.z, c1.z, c2.z, c3.z), az);
+
+		// in the same order as facing, so a triangle seen exactly edge on is dropped or kept the same either way.
+		__m128 normalX = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+		__m128 normalY = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+		__m128 normalZ = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, normalX), _mm_mul_ps(ay, normalY)), _mm_mul_ps(az, normalZ));
+		int front = _mm_movemask_ps(_mm_cmpgt_ps(dot, zero));
+
+		if (0xF == front && kept == index) {
+			kept += 12; // nothing dropped yet, so there is nothing to move.
+			continue;
+		}
+		for (int lane = 0; lane < 4; lane++) {
+			if (front & (1 << lane)) {
+				data[kept] = triangle[lane * 3];
+				data[kept + 1] = triangle[lane * 3 + 1];
+				data[kept + 2] = triangle[lane * 3 + 2];
+				kept += 3;
+			}
+		}
+	}
+#endif
+
+	for (; index < endIndex; index += 3) {
+		if (facing(verts[data[index]].pos, verts[data[index + 1]].pos, verts[data[index + 2]].pos) > 0) {
+			data[kept] = data[index];
+			data[kept + 1] = data[index + 1];
+			data[kept + 2] = data[index + 2];
+			kept += 3;
+		}
+	}
+
+	uint32_t dropped = (uint32_t)((endIndex - kept) / 3);
+	indices.resize(kept);
+	return dropped;
+}
+
+static Vertex lerpVertex(const Vertex& from, const Vertex& to, float t) {
+	Vertex temp;
+	temp.pos.x = from.pos.x + (to.pos.x - from.pos.x) * t;
+	temp.pos.y = from.pos.y + (to.pos.y - from.pos.y) * t;
+	temp.pos.z = from.pos.z + (to.pos.z - from.pos.z) * t;
+	for (int channel = 0; channel < 4; channel++) {
+		temp.color[channel] = from.color[channel] + (to.color[channel] - from.color[channel]) * t;
+	}
+	return temp;
+}
+
+// the vertex clipping made where an edge crosses a plane, by the edge (the lower vertex index in the high bits).
+// An edge is only ever cut once, by the first plane one of its ends is outside of, as any plane before that keeps both of its ends. So the
+// triangle on the other side of the edge, which is clipped against the same planes in the same order, gets the same vertex rather than a copy of it.
+using EdgeVertexMap = std::unordered_map<uint64_t, uint32_t, std::hash<uint64_t>, std::equal_to<uint64_t>, FrameAllocator<std::pair<const uint64_t, uint32_t>>>;
+
+// the index of the vertex where the edge between from and to crosses the plane, adding it to verts the first time the edge is cut.
+static uint32_t edgeVertex(std::vector<Vertex>& verts, uint32_t from, uint32_t to, const ClipPlane& plane, EdgeVertexMap& edgeVertices, ClipStats& stats) {
+	if (from > to) {
+		std::swap(from, to);
+	}
+	uint64_t edge = ((uint64_t)from << 32) | to;
+	auto found = edgeVertices.find(edge);
+	if (edgeVertices.end() != found) {
+		return found->second;
+	}
+
+	// always made from the lower index, so it does not matter which of the triangles on the edge gets here first.
+	float fromDistance = plane.distance(verts[from].pos);
+	float toDistance = plane.distance(verts[to].pos);
+	Vertex vertex = lerpVertex(verts[from], verts[to], fromDistance / (fromDistance - toDistance));
+
+	uint32_t index = (uint32_t)verts.size();
+	verts.push_back(vertex);
+	edgeVertices.emplace(edge, index);
+	stats.addedVertices++;
+	return index;
+}
+
+// Sutherland-Hodgman against the planes whose bits are in planeMask, the polygon that is left is added as a fan of triangles.
+// Returns false if nothing was left, which happens when the triangle passes by a corner of the frustum.
+static bool clipTriangle(std::vector<Vertex>& verts, const uint32_t* triangle, uint8_t planeMask, const ClipPlane* planes, int planeCount, FrameVector<uint32_t>& indexData, EdgeVertexMap& edgeVertices, ClipStats& stats) {
+	// a convex polygon gains at most one vertex per plane.
+	uint32_t polygon[3 + maxClipPlanes];
+	uint32_t clippedPolygon[3 + maxClipPlanes];
+	int count = 3;
+	for (int corner = 0; corner < 3; corner++) {
+		polygon[corner] = triangle[corner];
+	}
+
+	for (int plane = 0; plane < planeCount; plane++) {
+		if (0 == (planeMask & (1 << plane))) {
+			continue;
+		}
+
+		int clippedCount = 0;
+		for (int corner = 0; corner < count; corner++) {
+			uint32_t current = polygon[corner];
+			uint32_t next = polygon[(corner + 1) % count];
+			bool currentInside = planes[plane].distance(verts[current].pos) >= 0;
+			bool nextInside = planes[plane].distance(verts[next].pos) >= 0;
+
+			if (currentInside) {
+				clippedPolygon[clippedCount++] = current;
+			}
+			if (currentInside != nextInside) {
+				clippedPolygon[clippedCount++] = edgeVertex(verts, current, next, planes[plane], edgeVertices, stats);
+			}
+		}
+
+		memcpy(polygon, clippedPolygon, sizeof(uint32_t) * clippedCount);
+		count = clippedCount;
+
+		if (count < 3) {
+			stats.culledByPlane[plane]++;
+			return false;
+		}
+	}
+
+	// the polygon keeps the winding of the triangle, and so does the fan.
+	for (int corner = 1; corner + 1 < count; corner++) {
+		indexData.push_back(polygon[0]);
+		indexData.push_back(polygon[corner]);
+		indexData.push_back(polygon[corner + 1]);
+	}
+	return true;
+}
+
+void clipTriangles(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const ClipPlane* planes, int planeCount, FrameArena& frameArena, ClipStats* stats) {
+	if (planeCount > maxClipPlanes) {
+		throwError("clipTriangles takes at most " + std::to_string(maxClipPlanes) + " planes.", logLevelError);
+	}
+
+	ClipStats frameStats;
+	size_t vertexCount = verts.size();
+
+	FrameVector<uint8_t> outcodes(vertexCount, 0, FrameAllocator<uint8_t>(frameArena));
+	uint8_t allCodes = computeOutcodes(verts.data(), vertexCount, planes, planeCount, outcodes.data());
+
+	// nothing is outside of any plane, so every triangle is kept as it is.
+	if (0 == allCodes) {
+		frameStats.insideTriangles = (uint32_t)(indices.size() / 3);
+		if (nullptr != stats) {
+			*stats = frameStats;
+		}
+		return;
+	}
+
+	FrameVector<uint32_t> indexData{ FrameAllocator<uint32_t>(frameArena) };
+	indexData.reserve(indices.size() + indices.size() / 4);
+	EdgeVertexMap edgeVertices(64, std::hash<uint64_t>(), std::equal_to<uint64_t>(), FrameAllocator<std::pair<const uint64_t, uint32_t>>(frameArena));
+
+	for (size_t index = 0; index + 2 < indices.size(); index += 3) {
+		const uint32_t* triangle = &indices[index];
+		uint8_t code0 = outcodes[triangle[0]];
+		uint8_t code1 = outcodes[triangle[1]];
+		uint8_t code2 = outcodes[triangle[2]];
+
+		if (code0 & code1 & code2) {
+			frameStats.outsideTriangles++;
+			frameStats.culledByPlane[firstPlane(code0 & code1 & code2)]++;
+		}
+		else if (0 == (code0 | code1 | code2)) {
+			indexData.push_back(triangle[0]);
+			indexData.push_back(triangle[1]);
+			indexData.push_back(triangle[2]);
+			frameStats.insideTriangles++;
+		}
+		else if (clipTriangle(verts, triangle, code0 | code1 | code2, planes, planeCount, indexData, edgeVertices, frameStats)) {
+			frameStats.clippedTriangles++;
+		}
+		else {
+			frameStats.outsideTriangles++;
+		}
+	}
+
+	// copied back (rather than moved), so indices keeps its capacity and does not have to grow again next frame.
+	indices.assign(indexData.begin(), indexData.end());
+
+	if (nullptr != stats) {
+		*stats = frameStats;
+	}
+}
+
+void clipVertices(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, float scaleLeft, bool compareLessThan, float scaleRight, bool xUsed, bool flip, FrameArena& frameArena) {
+
+	// the clipped triangles are built in frame memory, a triangle becomes at most 4 vertices and 6 indices.
+	FrameVector<Vertex> vecData{ FrameAllocator<Vertex>(frameArena) };
+	FrameVector<uint32_t> indexData{ FrameAllocator<uint32_t>(frameArena) };
+	vecData.reserve(indices.size() / 3 * 4);
+	indexData.reserve(indices.size() * 2);
+
+	int oobCount = 0; // out of bounds count
+	// compare left x
+	for (int index = 0; index < indices.size(); index += 3) {
+		bool first = false, second = false, third = false;
+		
+		if (xUsed) {
+			if (compareLessThan) {
+				first = verts[indices[index]].pos.x * scaleLeft < scaleRight * verts[indices[index]].pos.z;
+				second = verts[indices[index + 1]].pos.x * scaleLeft < scaleRight * verts[indices[index + 1]].pos.z;
+				third = verts[indices[index + 2]].pos.x * scaleLeft < scaleRight * verts[indices[index + 2]].pos.z;
+			}
+			else {
+				first = verts[indices[index]].pos.x * scaleLeft > scaleRight * verts[indices[index]].pos.z;
+				second = verts[indices[index + 1]].pos.x * scaleLeft > scaleRight * verts[indices[index + 1]].pos.z;
+				third = verts[indices[index + 2]].pos.x * scaleLeft > scaleRight * verts[indices[index + 2]].pos.z;
+			}
+		} else {
+			if (compareLessThan) {
+				first = verts[indices[index]].pos.y * scaleLeft < scaleRight * verts[indices[index]].pos.z;
+				second = verts[indices[index + 1]].pos.y * scaleLeft < scaleRight * verts[indices[index + 1]].pos.z;
+				third = verts[indices[index + 2]].pos.y * scaleLeft < scaleRight * verts[indices[index + 2]].pos.z;
+			}
+			else {
+				first = verts[indices[index]].pos.y * scaleLeft > scaleRight * verts[indices[index]].pos.z;
+				second = verts[indices[index + 1]].pos.y * scaleLeft > scaleRight * verts[indices[index + 1]].pos.z;
+				third = verts[indices[index + 2]].pos.y * scaleLeft > scaleRight * verts[indices[index + 2]].pos.z;
+			}
+		}
+
+		oobCount = 0;
+
+		if (first) {
+			oobCount++;
+		}
+		if (second) {
+			oobCount++;
+		}
+		if (third) {
+			oobCount++;
+		}
+
+		int size = vecData.size();
+
+		//std::cout << oobCount << " " << first << second << third <<  "\r";
+
+		Vertex p1 = verts[indices[index]];
+		Vec3 v1 = verts[indices[index]].pos;
+		Vertex p2 = verts[indices[index + 1]];
+		Vec3 v2 = verts[indices[index + 1]].pos;
+		Vertex p3 = verts[indices[index + 2]];
+		Vec3 v3 = verts[indices[index + 2]].pos;
+
+		Vec3 normal;
+		if (!flip) {
+			if (xUsed) {
+				normal = { scaleLeft, 0, 1 };
+			}
+			else {
+				normal = { 0, scaleLeft, 1 };
+			}
+		} else {
+			if (xUsed) {
+				normal = { -scaleLeft, 0, 1 };
+			}
+			else {
+				normal = { 0, -scaleLeft, 1 };
+			}
+		}
+
+		switch (oobCount) {
+		case 0:
+			vecData.push_back(p1);
+			vecData.push_back(p2);
+			vecData.push_back(p3);
+			indexData.push_back(size);
+			indexData.push_back(size + 1);
+			indexData.push_back(size + 2);
+			break;
+		case 1:
+			if (first) {
+				Vec3 V1to2 = v2 - v1;
+				Vec3 V1to3 = v3 - v1;
+
+				float dot1to2 = Vec3::dot(V1to2, normal);
+				float dot1to3 = Vec3::dot(V1to3, normal);
+
+				Vec3 w = v1 - Vec3{ 0, 0, 0 };
+				float fac1to2 = -Vec3::dot(normal, w) / dot1to2;
+				float fac1to3 = -Vec3::dot(normal, w) / dot1to3;
+
+				V1to2 = fac1to2 * V1to2;
+				V1to3 = fac1to3 * V1to3;
+
+				Vec3 poi1n2 = v1 + V1to2;
+				Vec3 poi1n3 = v1 + V1to3;
+
+				Vertex V4 = p1;
+				Vertex V5 = p1;
+
+				V4.pos = poi1n2;
+				V5.pos = poi1n3;
+
+				vecData.push_back(V4);
+				vecData.push_back(V5);
+				vecData.push_back(verts[ indices[index + 1]]);
+				vecData.push_back(verts[ indices[index + 2]]);
+				indexData.push_back(size);
+				indexData.push_back(size + 2);
+				indexData.push_back(size + 3);
+				indexData.push_back(size);
+				indexData.push_back(size + 3);
+				indexData.push_back(size + 1);
+			}
+			else if (second) {
+				Vec3 V2to1 = v1 - v2;
+				Vec3 V2to3 = v3 - v2;
+
+				float dot2to1 = Vec3::dot(V2to1, normal);
+				float dot2to3 = Vec3::dot(V2to3, normal);
+
+				Vec3 w = v2 - Vec3{ 0, 0, 0 };
+				float fac2to1 = -Vec3::dot(normal, w) / dot2to1;
+				float fac2to3 = -Vec3::dot(normal, w) / dot2to3;
+
+				V2to1 = fac2to1 * V2to1;
+				V2to3 = fac2to3 * V2to3;
+
+				Vec3 poi2n1 = v2 + V2to1;
+				Vec3 poi2n3 = v2 + V2to3;
+
+				Vertex V4 = p2;
+				Vertex V5 = p2;
+
+				V4.pos = poi2n1;
+				V5.pos = poi2n3;
+
+				vecData.push_back(verts[indices[index]]);
+				vecData.push_back(V4);
+				vecData.push_back(V5);
+				vecData.push_back(verts[indices[index + 2]]);
+				indexData.push_back(size);
+				indexData.push_back(size + 1);
+				indexData.push_back(size + 2);
+				indexData.push_back(size);
+				indexData.push_back(size + 2);
+				indexData.push_back(size + 3);
+			}
+			else if (third) {
+
+				Vec3 V3to1 = v1 - v3;
+				Vec3 V3to2 = v2 - v3;
+
+				float dot3to1 = Vec3::dot(V3to1, normal);
+				float dot3to2 = Vec3::dot(V3to2, normal);
+
+				Vec3 w = v3 - Vec3{ 0, 0, 0 };
+				float fac3to1 = -Vec3::dot(normal, w) / dot3to1;
+				float fac3to2 = -Vec3::dot(normal, w) / dot3to2;
+
+				V3to1 = fac3to1 * V3to1;
+				V3to2 = fac3to2 * V3to2;
+
+				Vec3 poi3n1 = v3 + V3to1;
+				Vec3 poi3n2 = v3 + V3to2;
+
+				Vertex V4 = p3;
+				Vertex V5 = p3;
+
+				V4.pos = poi3n1;
+				V5.pos = poi3n2;
+
+				vecData.push_back(verts[indices[index]]);
+				vecData.push_back(verts[indices[index + 1]]);
+				vecData.push_back(V4);
+				vecData.push_back(V5);
+				indexData.push_back(size);
+				indexData.push_back(size + 1);
+				indexData.push_back(size + 3);
+				indexData.push_back(size);
+				indexData.push_back(size + 3);
+				indexData.push_back(size + 2);
+			}
+			break;
+		case 2:
+			if (first && second) {
+				Vec3 V3to1 = v1 - v3;
+				Vec3 V3to2 = v2 - v3;
+
+				float dot3to1 = Vec3::dot(V3to1, normal);
+				float dot3to2 = Vec3::dot(V3to2, normal);
+
+				Vec3 w = v3 - Vec3{ 0, 0, 0 };
+				float fac3to1 = -Vec3::dot(normal, w) / dot3to1;
+				float fac3to2 = -Vec3::dot(normal, w) / dot3to2;
+
+				V3to1 = fac3to1 * V3to1;
+				V3to2 = fac3to2 * V3to2;
+
+				Vec3 poi3n1 = v3 + V3to1;
+				Vec3 poi3n2 = v3 + V3to2;
+
+				Vertex V4=p3;
+				Vertex V5=p3;
+
+				V4.pos = poi3n1;
+				V5.pos = poi3n2;
+
+				vecData.push_back(V4);
+				vecData.push_back(V5);
+				vecData.push_back(verts[indices[index + 2]]);
+				indexData.push_back(size);
+				indexData.push_back(size + 1);
+				indexData.push_back(size + 2);
+
+			}
+			else if (first && third) {
+				Vec3 V2to1 = v1 - v2;
+				Vec3 V2to3 = v3 - v2;
+
+				float dot2to1 = Vec3::dot(V2to1, normal);
+				float dot2to3 = Vec3::dot(V2to3, normal);
+
+				Vec3 w = v2 - Vec3{ 0, 0, 0 };
+				float fac2to1 = -Vec3::dot(normal, w) / dot2to1;
+				float fac2to3 = -Vec3::dot(normal, w) / dot2to3;
+
+				V2to1 = fac2to1 * V2to1;
+				V2to3 = fac2to3 * V2to3;
+
+				Vec3 poi2n1 = v2 + V2to1;
+				Vec3 poi2n3 = v2 + V2to3;
+
+				Vertex V4 = p2;
+				Vertex V5 = p2;
+
+				V4.pos = poi2n1;
+				V5.pos = poi2n3;
+
+				vecData.push_back(V4);
+				vecData.push_back(verts[indices[index + 1]]);
+				vecData.push_back(V5);
+				indexData.push_back(size);
+				indexData.push_back(size + 1);
+				indexData.push_back(size + 2);
+			}
+			else if (second && third) {
+				Vec3 V1to2 = v2 - v1;
+				Vec3 V1to3 = v3 - v1;
+
+				float dot1to2 = Vec3::dot(V1to2, normal);
+				float dot1to3 = Vec3::dot(V1to3, normal);
+
+				Vec3 w = v1 - Vec3{ 0, 0, 0 };
+				float fac1to2 = -Vec3::dot(normal, w) / dot1to2;
+				float fac1to3 = -Vec3::dot(normal, w) / dot1to3;
+
+				V1to2 = fac1to2 * V1to2;
+				V1to3 = fac1to3 * V1to3;
+
+				Vec3 poi1n2 = v1 + V1to2;
+				Vec3 poi1n3 = v1 + V1to3;
+
+				Vertex V4 = p1;
+				Vertex V5 = p1;
+
+				V4.pos = poi1n2;
+				V5.pos = poi1n3;
+
+				vecData.push_back(verts[indices[index]]);
+				vecData.push_back(V4);
+				vecData.push_back(V5);
+				indexData.push_back(size);
+				indexData.push_back(size + 1);
+				indexData.push_back(size + 2);
+			}
+		case 3:
+			break;
+		default:
+			break;
+		}
+	}
+
+	 // copied back (rather than moved), so verts and indices keep their capacity and do not have to grow again next frame.
+	 verts.assign(vecData.begin(), vecData.end());
+	 indices.assign(indexData.begin(), indexData.end());
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Engine/Entity/Vertex.h"
+#include "Engine/MemoryArena/FrameArena.h"
+#include <vector>
+#include <cstdint>
+
+// A plane the triangles are clipped to, a point p is inside when a * p.x + b * p.y + c * p.z + d >= 0.
+struct ClipPlane {
+	float a = 0, b = 0, c = 0, d = 0;
+
+	float distance(const Vec3& point) const {
+		return a * point.x + b * point.y + c * point.z + d;
+	}
+};
+
+// the most planes clipTriangles takes, a vertex keeps a bit per plane it is outside of.
+const int maxClipPlanes = 8;
+
+// the names of the planes frustumPlanes makes, in the same order.
+static const char* const frustumPlaneNames[] = { "near", "far", "left", "top", "right", "bottom" };
+
+struct ClipStats {
+	uint32_t insideTriangles = 0; // kept as they were.
+	uint32_t outsideTriangles = 0; // dropped, as nothing of them was inside all of the planes.
+	uint32_t clippedTriangles = 0; // cut by one or more planes, and kept.
+	uint32_t addedVertices = 0;
+	uint32_t culledByPlane[maxClipPlanes] = {}; // the dropped triangles by the plane they were dropped for, the first plane all of their vertices were outside of or the one that cut away what was left of them.
+	uint32_t culledObjects = 0; // left out whole by classifyBounds, none of their triangles are counted above.
+	uint32_t unclippedObjects = 0; // inside of every plane, so their triangles never went through clipTriangles.
+	uint32_t backFaceTriangles = 0; // dropped by cullBackFaces before clipping.
+
+	void add(const ClipStats& other) {
+		insideTriangles += other.insideTriangles;
+		outsideTriangles += other.outsideTriangles;
+		clippedTriangles += other.clippedTriangles;
+		addedVertices += other.addedVertices;
+		for (int plane = 0; plane < maxClipPlanes; plane++) {
+			culledByPlane[plane] += other.culledByPlane[plane];
+		}
+		culledObjects += other.culledObjects;
+		unclippedObjects += other.unclippedObjects;
+		backFaceTriangles += other.backFaceTriangles;
+	}
+};
+
+// fills planes with the four side planes of the view frustum (left, top, right, bottom), scaleX and scaleY are the same scales the projection matrix uses.
+// Returns the number of planes.
+int frustumSidePlanes(float scaleX, float scaleY, ClipPlane* planes);
+
+// the near and far planes at zNear and zFar (Renderer::Context::Znear and Zfar), followed by the side planes. Returns the number of planes.
+int frustumPlanes(float scaleX, float scaleY, float zNear, float zFar, ClipPlane* planes);
+
+// Where an object is, as a whole, against the planes.
+enum BoundsClip {
+	boundsOutside,	// all of it is outside of one of the planes, so none of it can be seen.
+	boundsInside,	// all of it is inside of every plane, so its triangles need no clipping.
+	boundsCrossing	// it might cross a plane, so its triangles have to be clipped.
+};
+
+// Tests a mesh's bounds (Mesh::updateBounds) put where transform puts them against the planes. The sphere is tested first, as it takes one
+// distance per plane; only when it crosses a plane are the 8 corners of the box tested as well, which is tighter for long, flat meshes like the floor.
+BoundsClip classifyBounds(const Vec3& boundsMin, const Vec3& boundsMax, const Vec3& boundsCenter, float boundsRadius, const Mat4& transform, const ClipPlane* planes, int planeCount);
+
+// Drops the triangles in indices from firstIndex on that face away from the camera (at the origin), the ones kept stay in the same order.
+// A triangle faces the camera when dot(v1, cross(v2 - v1, v3 - v1)) > 0, which is the clockwise winding on screen the pipeline calls front facing.
+// Works on 4 triangles at a time with SSE. Returns the number of triangles dropped.
+uint32_t cullBackFaces(const std::vector<Vertex>& verts, std::vector<uint32_t>& indices, size_t firstIndex = 0);
+
+// Clips the triangles to all of the planes in one pass.
+// First every vertex gets a bit per plane it is outside of (with SSE, 4 vertices at a time). Then a triangle whose vertices are all outside of one plane is dropped,
+// and one whose vertices are all inside is kept with its indices as they are, neither of which touches the vertices again. Only the triangles that cross a plane
+// are clipped (Sutherland-Hodgman against just the planes they cross), the vertices that adds are put at the end of verts. A vertex made on an edge is
+// made once and shared by both triangles on that edge, so indexed meshes stay indexed.
+// verts keeps every vertex it had, so indices into it stay valid. The frame arena holds the scratch memory.
+void clipTriangles(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const ClipPlane* planes, int planeCount, FrameArena& frameArena, ClipStats* stats = nullptr);
+
+// The clipper clipTriangles replaced, which clips against one plane per call and writes every triangle it keeps out as new vertices.
+// It is kept to compare against in _TEST_Clipping.
+void clipVertices(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, float scaleLeft, bool compareLessThan, float scaleRight, bool xUsed, bool flip, FrameArena& frameArena);
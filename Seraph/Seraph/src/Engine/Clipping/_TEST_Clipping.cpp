@@ -0,0 +1,382 @@
+#include "FrustumClipper.h"
+#include "_TEST_Clipping.h"
+#include "Engine/Entity/World.h"
+#include "CommonIncludes.h"
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// the scales runEngine clips with for a 16:9 window and a 90 degree field of view.
+static const float testScaleX = 1.0f * 9.0f / 16.0f;
+static const float testScaleY = 1.0f;
+
+static double triangleArea(const std::vector<Vertex>& verts, const std::vector<uint32_t>& indices, size_t index) {
+	Vec3 v1 = verts[indices[index]].pos;
+	Vec3 v2 = verts[indices[index + 1]].pos;
+	Vec3 v3 = verts[indices[index + 2]].pos;
+	return Vec3::cross(v2 - v1, v3 - v1).abs() / 2;
+}
+
+static double meshArea(const std::vector<Vertex>& verts, const std::vector<uint32_t>& indices) {
+	double area = 0;
+	for (size_t index = 0; index + 2 < indices.size(); index += 3) {
+		area += triangleArea(verts, indices, index);
+	}
+	return area;
+}
+
+static void clipWithClipVertices(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, FrameArena& frameArena) {
+	clipVertices(verts, indices, testScaleX, true, -1.0, true, false, frameArena);
+	clipVertices(verts, indices, testScaleY, true, -1.0, false, false, frameArena);
+	clipVertices(verts, indices, testScaleX, false, 1.0, true, true, frameArena);
+	clipVertices(verts, indices, testScaleY, false, 1.0, false, true, frameArena);
+}
+
+int testFrustumClipper() {
+	int failures = 0;
+	FrameArena frameArena(1 << 20, 2);
+
+	ClipPlane planes[maxClipPlanes];
+	int planeCount = frustumSidePlanes(testScaleX, testScaleY, planes);
+
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> depth(0.5f, 6.0f);
+
+	for (int round = 0; round < 20; round++) {
+		frameArena.beginFrame();
+
+		// triangles of every size, so some are inside, some outside and some cross one or more planes.
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		for (int triangle = 0; triangle < 500; triangle++) {
+			for (int corner = 0; corner < 3; corner++) {
+				indices.push_back((uint32_t)verts.size());
+				verts.push_back({ { position(random), position(random), depth(random) }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+			}
+		}
+		uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+		std::vector<Vertex> oldVerts = verts;
+		std::vector<uint32_t> oldIndices = indices;
+		clipWithClipVertices(oldVerts, oldIndices, frameArena);
+
+		ClipStats stats;
+		clipTriangles(verts, indices, planes, planeCount, frameArena, &stats);
+
+		if (stats.insideTriangles + stats.outsideTriangles + stats.clippedTriangles != triangleCount) {
+			logRecord("The clip stats do not add up to the number of triangles.", logLevelError);
+			failures++;
+		}
+
+		for (uint32_t index : indices) {
+			if (index >= verts.size()) {
+				logRecord("A clipped triangle points past the vertices.", logLevelError);
+				failures++;
+				break;
+			}
+			for (int plane = 0; plane < planeCount; plane++) {
+				if (planes[plane].distance(verts[index].pos) < -1e-4f) {
+					logRecord("A vertex is left outside of plane " + std::to_string(plane) + ".", logLevelError);
+					failures++;
+					break;
+				}
+			}
+		}
+
+		double area = meshArea(verts, indices);
+		double oldArea = meshArea(oldVerts, oldIndices);
+		if (fabs(area - oldArea) > 1e-3 * (oldArea + 1)) {
+			logRecord("The clipped triangles cover " + std::to_string(area) + " instead of " + std::to_string(oldArea) + ".", logLevelError);
+			failures++;
+		}
+	}
+
+	// the full frustum, with triangles behind the camera and past the far plane.
+	ClipPlane allPlanes[maxClipPlanes];
+	int allPlaneCount = frustumPlanes(testScaleX, testScaleY, 0.1f, 20.0f, allPlanes);
+	std::uniform_real_distribution<float> anyDepth(-10.0f, 30.0f);
+
+	for (int round = 0; round < 20; round++) {
+		frameArena.beginFrame();
+
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		for (int triangle = 0; triangle < 500; triangle++) {
+			for (int corner = 0; corner < 3; corner++) {
+				indices.push_back((uint32_t)verts.size());
+				verts.push_back({ { position(random), position(random), anyDepth(random) }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+			}
+		}
+
+		ClipStats stats;
+		clipTriangles(verts, indices, allPlanes, allPlaneCount, frameArena, &stats);
+
+		uint32_t culled = 0;
+		for (int plane = 0; plane < maxClipPlanes; plane++) {
+			culled += stats.culledByPlane[plane];
+		}
+		if (culled != stats.outsideTriangles || stats.insideTriangles + stats.outsideTriangles + stats.clippedTriangles != 500) {
+			logRecord("The per plane cull counts do not add up to the dropped triangles.", logLevelError);
+			failures++;
+		}
+
+		for (uint32_t index : indices) {
+			for (int plane = 0; plane < allPlaneCount; plane++) {
+				if (allPlanes[plane].distance(verts[index].pos) < -1e-3f) {
+					logRecord("A vertex is left outside of the " + std::string(frustumPlaneNames[plane]) + " plane.", logLevelError);
+					failures++;
+					break;
+				}
+			}
+		}
+	}
+
+	// one triangle behind the camera and one past the far plane, each counted against its plane.
+	{
+		frameArena.beginFrame();
+		std::vector<Vertex> verts = { { { 0, 0, -1 } }, { { 0.1f, 0, -1 } }, { { 0, 0.1f, -1 } }, { { 0, 0, 25 } }, { { 0.1f, 0, 25 } }, { { 0, 0.1f, 25 } } };
+		std::vector<uint32_t> indices = { 0, 1, 2, 3, 4, 5 };
+		ClipStats stats;
+		clipTriangles(verts, indices, allPlanes, allPlaneCount, frameArena, &stats);
+		if (!indices.empty() || 1 != stats.culledByPlane[0] || 1 != stats.culledByPlane[1]) {
+			logRecord("Triangles behind the camera or past the far plane were not culled by the near and far planes.", logLevelError);
+			failures++;
+		}
+	}
+
+	// a grid whose triangles share their vertices, an edge that crosses a plane has to get one new vertex, not one for each triangle on it.
+	{
+		frameArena.beginFrame();
+		const int side = 40;
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		for (int row = 0; row < side; row++) {
+			for (int column = 0; column < side; column++) {
+				verts.push_back({ { (column - side / 2) * 0.13f, (row - side / 2) * 0.11f, 2.0f + row * 0.01f }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+			}
+		}
+		for (int row = 0; row + 1 < side; row++) {
+			for (int column = 0; column + 1 < side; column++) {
+				uint32_t corner = row * side + column;
+				indices.insert(indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+			}
+		}
+		size_t gridVertexCount = verts.size();
+		double expectedArea = 0;
+		{
+			std::vector<Vertex> oldVerts = verts;
+			std::vector<uint32_t> oldIndices = indices;
+			clipWithClipVertices(oldVerts, oldIndices, frameArena);
+			expectedArea = meshArea(oldVerts, oldIndices);
+		}
+
+		ClipStats stats;
+		clipTriangles(verts, indices, planes, planeCount, frameArena, &stats);
+
+		std::vector<Vec3> added;
+		for (size_t index = gridVertexCount; index < verts.size(); index++) {
+			added.push_back(verts[index].pos);
+		}
+		std::sort(added.begin(), added.end(), [](const Vec3& a, const Vec3& b) { return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z; });
+		bool copied = std::adjacent_find(added.begin(), added.end(), [](const Vec3& a, const Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }) != added.end();
+		double area = meshArea(verts, indices);
+		if (0 == stats.clippedTriangles || copied || abs(area - expectedArea) > 1e-3 * expectedArea) {
+			logRecord("Clipping the shared grid made copies of a vertex on an edge, or covered " + std::to_string(area) + " instead of " + std::to_string(expectedArea) + ".", logLevelError);
+			failures++;
+		}
+	}
+
+	// a mesh moved all around the frustum, classifyBounds may only call it outside or inside when every vertex is.
+	{
+		Mesh mesh;
+		mesh.m_vertexCount = 200;
+		mesh.m_vertexData = new Vertex[mesh.m_vertexCount];
+		std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+		for (uint32_t index = 0; index < mesh.m_vertexCount; index++) {
+			mesh.m_vertexData[index] = { { offset(random) * 3.0f, offset(random) * 0.2f, offset(random) }, { 1.0f, 1.0f, 1.0f, 1.0f } };
+		}
+		mesh.updateBounds();
+
+		int classified[3] = {};
+		for (int placement = 0; placement < 2000; placement++) {
+			Mat4 transform = Mat4::rotationX(offset(random) * 3.0f) * Mat4::rotationY(offset(random) * 3.0f) * Mat4::translation(position(random), position(random), anyDepth(random));
+			BoundsClip clip = classifyBounds(mesh.m_boundsMin, mesh.m_boundsMax, mesh.m_boundsCenter, mesh.m_boundsRadius, transform, allPlanes, allPlaneCount);
+			classified[clip]++;
+
+			uint8_t outsideAll = 0xFF;
+			uint8_t outsideAny = 0;
+			for (uint32_t index = 0; index < mesh.m_vertexCount; index++) {
+				Vec3 point = transform.transformPoint(mesh.m_vertexData[index].pos);
+				uint8_t code = 0;
+				for (int plane = 0; plane < allPlaneCount; plane++) {
+					if (allPlanes[plane].distance(point) < 0) {
+						code |= 1 << plane;
+					}
+				}
+				outsideAll &= code;
+				outsideAny |= code;
+			}
+			if ((boundsOutside == clip && !outsideAll) || (boundsInside == clip && outsideAny)) {
+				logRecord("classifyBounds called a mesh " + std::string(boundsOutside == clip ? "outside" : "inside") + " when it was not.", logLevelError);
+				failures++;
+			}
+		}
+		if (0 == classified[boundsOutside] || 0 == classified[boundsInside] || 0 == classified[boundsCrossing]) {
+			logRecord("classifyBounds did not see the mesh outside, inside and crossing.", logLevelError);
+			failures++;
+		}
+	}
+
+	// cullBackFaces against the normal of each triangle worked out one at a time, after a first part of the indices it has to leave alone.
+	{
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		for (int triangle = 0; triangle < 1001; triangle++) {
+			for (int corner = 0; corner < 3; corner++) {
+				indices.push_back((uint32_t)verts.size());
+				verts.push_back({ { position(random), position(random), anyDepth(random) }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+			}
+		}
+		const size_t firstIndex = 30;
+
+		std::vector<uint32_t> expected(indices.begin(), indices.begin() + firstIndex);
+		bool edgeOn = false;
+		for (size_t index = firstIndex; index < indices.size(); index += 3) {
+			Vec3 v1 = verts[indices[index]].pos;
+			Vec3 v2 = verts[indices[index + 1]].pos;
+			Vec3 v3 = verts[indices[index + 2]].pos;
+			float facing = Vec3::dot(v1, Vec3::cross(v2 - v1, v3 - v1));
+			edgeOn |= abs(facing) < 1e-4f;
+			if (facing > 0) {
+				expected.insert(expected.end(), { indices[index], indices[index + 1], indices[index + 2] });
+			}
+		}
+
+		uint32_t dropped = cullBackFaces(verts, indices, firstIndex);
+		if (!edgeOn && (indices != expected || dropped != 1001 - expected.size() / 3)) {
+			logRecord("cullBackFaces kept " + std::to_string(indices.size() / 3) + " triangles instead of " + std::to_string(expected.size() / 3) + ".", logLevelError);
+			failures++;
+		}
+	}
+
+	logRecord("Frustum clipper test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// clips copies of the mesh a number of times with both clippers, and logs the average time each took.
+static void timeClippers(const char* name, const std::vector<Vertex>& verts, const std::vector<uint32_t>& indices, int repeats, FrameArena& frameArena) {
+	ClipPlane planes[maxClipPlanes];
+	int planeCount = frustumSidePlanes(testScaleX, testScaleY, planes);
+
+	std::vector<Vertex> clipVerts;
+	std::vector<uint32_t> clipIndices;
+	double oldMilliseconds = 0;
+	double newMilliseconds = 0;
+	size_t oldTriangles = 0;
+	ClipStats stats;
+
+	for (int repeat = 0; repeat < repeats; repeat++) {
+		frameArena.beginFrame();
+		clipVerts = verts;
+		clipIndices = indices;
+		auto start = std::chrono::steady_clock::now();
+		clipWithClipVertices(clipVerts, clipIndices, frameArena);
+		oldMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		oldTriangles = clipIndices.size() / 3;
+
+		frameArena.beginFrame();
+		clipVerts = verts;
+		clipIndices = indices;
+		start = std::chrono::steady_clock::now();
+		clipTriangles(clipVerts, clipIndices, planes, planeCount, frameArena, &stats);
+		newMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	logRecord(std::string(name) + ", " + std::to_string(indices.size() / 3) + " triangles: clipVertices x4 " + std::to_string(oldMilliseconds / repeats) + "ms ("
+		+ std::to_string(oldTriangles) + " triangles left), clipTriangles " + std::to_string(newMilliseconds / repeats) + "ms (" + std::to_string(clipIndices.size() / 3)
+		+ " triangles left, " + std::to_string(stats.insideTriangles) + " inside, " + std::to_string(stats.outsideTriangles) + " outside, "
+		+ std::to_string(stats.clippedTriangles) + " clipped).", logLevelInfo);
+}
+
+int benchmarkFrustumClipper() {
+	FrameArena frameArena(4 << 20, 2);
+
+	// the teapot as runEngine streams it (every triangle with vertices of its own), in front of the camera and over the right side of the screen.
+	{
+		Mesh teapotMesh;
+		teapotMesh.loadMesh("src/teapot.txt");
+		GameObject teapot;
+		teapot.mesh = &teapotMesh;
+		teapot.shiftMesh(1.0f, 0, 2.5f);
+
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		teapot.addToBufferNoIndex(verts, indices);
+		timeClippers("teapot", verts, indices, 200, frameArena);
+
+		// and as it is streamed now, with the vertices shared between its triangles.
+		std::vector<Vertex> sharedVerts;
+		std::vector<uint32_t> sharedIndices;
+		teapot.addToBuffer(sharedVerts, sharedIndices);
+		timeClippers("indexed teapot", sharedVerts, sharedIndices, 200, frameArena);
+
+		ClipPlane planes[maxClipPlanes];
+		int planeCount = frustumSidePlanes(testScaleX, testScaleY, planes);
+		frameArena.beginFrame();
+		clipTriangles(verts, indices, planes, planeCount, frameArena);
+		clipTriangles(sharedVerts, sharedIndices, planes, planeCount, frameArena);
+		// the back faces, as streamVisibleObjects drops them before clipping.
+		std::vector<uint32_t> cullIndices;
+		uint32_t dropped = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < 200; repeat++) {
+			cullIndices = sharedIndices;
+			dropped = cullBackFaces(sharedVerts, cullIndices);
+		}
+		logRecord("teapot back faces: " + std::to_string(dropped) + " of " + std::to_string(sharedIndices.size() / 3) + " triangles dropped in "
+			+ std::to_string(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / 200) + "ms.", logLevelInfo);
+
+		logRecord("teapot vertices streamed after clipping: " + std::to_string(verts.size()) + " with a vertex per corner, " + std::to_string(sharedVerts.size()) + " shared ("
+			+ std::to_string(sharedVerts.size() * sizeof(Vertex) + sharedIndices.size() * sizeof(uint32_t)) + " bytes instead of "
+			+ std::to_string(verts.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t)) + ").", logLevelInfo);
+	}
+
+	// a wavy grid of a million triangles that reaches past every side of the screen.
+	{
+		const int side = 708; // 707 * 707 * 2 is just over a million triangles.
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		verts.reserve(side * side);
+		indices.reserve((side - 1) * (side - 1) * 6);
+		for (int row = 0; row < side; row++) {
+			for (int column = 0; column < side; column++) {
+				float x = (column - side / 2) * 0.05f;
+				float z = 1.0f + row * 0.05f;
+				verts.push_back({ { x, 1.0f + sinf(x) * sinf(z) * 8.0f, z }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+			}
+		}
+		for (int row = 0; row + 1 < side; row++) {
+			for (int column = 0; column + 1 < side; column++) {
+				uint32_t corner = row * side + column;
+				indices.insert(indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+			}
+		}
+		timeClippers("synthetic grid", verts, indices, 5, frameArena);
+
+		std::vector<uint32_t> cullIndices;
+		uint32_t dropped = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < 5; repeat++) {
+			cullIndices = indices;
+			dropped = cullBackFaces(verts, cullIndices);
+		}
+		logRecord("synthetic grid back faces: " + std::to_string(dropped) + " of " + std::to_string(indices.size() / 3) + " triangles dropped in "
+			+ std::to_string(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / 5) + "ms.", logLevelInfo);
+	}
+
+	return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// clips random triangles and checks that what is left is inside every plane and covers the same area as what clipVertices leaves,
+// that the triangles dropped by the near and far planes are counted against them, that an edge shared by two triangles is only cut once,
+// that classifyBounds only calls a mesh outside or inside when all of it is, and that cullBackFaces keeps the triangles that face the camera.
+int testFrustumClipper();
+
+// times clipTriangles against the four clipVertices calls it replaced, on the teapot (as runEngine places it, with and without shared vertices) and on a mesh of a million triangles,
+// along with cullBackFaces on both.
+int benchmarkFrustumClipper();
@@ -63,6 +63,60 @@ Vec3 operator*(double scale, Vec3& rhs);
 Vec3 operator/(Vec3& lhs, double scale);
 Vec3& operator/=(Vec3& lhs, double scale);
 
+// A 4 by 4 matrix stored row by row that transforms column vectors (M * p), the same layout the projection matrix is written in,
+// so it can be handed to the shaders as is (they multiply vec4 * matrix).
+struct Mat4 {
+	float m[16] = { 1, 0, 0, 0,
+	                0, 1, 0, 0,
+	                0, 0, 1, 0,
+	                0, 0, 0, 1 };
+
+	Mat4 operator*(const Mat4& rhs) const {
+		Mat4 temp;
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				temp.m[row * 4 + column] = m[row * 4] * rhs.m[column] + m[row * 4 + 1] * rhs.m[4 + column] + m[row * 4 + 2] * rhs.m[8 + column] + m[row * 4 + 3] * rhs.m[12 + column];
+			}
+		}
+		return temp;
+	}
+
+	Vec3 transformPoint(const Vec3& point) const {
+		Vec3 temp = { m[0] * point.x + m[1] * point.y + m[2] * point.z + m[3],
+		              m[4] * point.x + m[5] * point.y + m[6] * point.z + m[7],
+		              m[8] * point.x + m[9] * point.y + m[10] * point.z + m[11] };
+		return temp;
+	}
+
+	static Mat4 translation(float x, float y, float z) {
+		Mat4 temp;
+		temp.m[3] = x;
+		temp.m[7] = y;
+		temp.m[11] = z;
+		return temp;
+	}
+
+	// spins x towards z, like GameObject::shiftNRot's spinAlongY.
+	static Mat4 rotationY(float angle) {
+		Mat4 temp;
+		temp.m[0] = cosf(angle);
+		temp.m[2] = sinf(angle);
+		temp.m[8] = -sinf(angle);
+		temp.m[10] = cosf(angle);
+		return temp;
+	}
+
+	// spins y away from z, like GameObject::shiftNRot's spinAlongX.
+	static Mat4 rotationX(float angle) {
+		Mat4 temp;
+		temp.m[5] = cosf(angle);
+		temp.m[6] = -sinf(angle);
+		temp.m[9] = sinf(angle);
+		temp.m[10] = cosf(angle);
+		return temp;
+	}
+};
+
 struct Vertex {
 	Vec3 pos;
 	float color[4];
@@ -91,4 +145,48 @@ struct Vertex {
 
 		return attributeDescriptions;
 	}
-};
\ No newline at end of file
+};
+
+// What each copy of an instanced mesh is drawn with, read per instance from vertex binding 1.
+struct InstanceData {
+	Mat4 transform; // applied before the transform of the draw.
+	float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; // multiplies the vertex colours.
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	// the transform takes four locations, a row each.
+	static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+
+		for (uint32_t row = 0; row < 4; row++) {
+			attributeDescriptions[row].binding = 1;
+			attributeDescriptions[row].location = 2 + row;
+			attributeDescriptions[row].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[row].offset = offsetof(InstanceData, transform) + sizeof(float) * 4 * row;
+		}
+
+		attributeDescriptions[4].binding = 1;
+		attributeDescriptions[4].location = 6;
+		attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[4].offset = offsetof(InstanceData, color);
+
+		return attributeDescriptions;
+	}
+};
+
+// Indices are kept as 32 bit on the cpu. When every index into the vertices fits in 16 bits they are narrowed to that when they are given to the gpu,
+// which halves the index bandwidth.
+inline VkIndexType indexTypeFor(size_t vertexCount) {
+	return vertexCount <= 0x10000 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+inline uint32_t indexSizeOf(VkIndexType indexType) {
+	return VK_INDEX_TYPE_UINT16 == indexType ? sizeof(uint16_t) : sizeof(uint32_t);
+}
\ No newline at end of file
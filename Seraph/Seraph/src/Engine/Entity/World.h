@@ -3,6 +3,7 @@
 #include "Vertex.h"
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 class Entity;
 
@@ -52,12 +53,43 @@ struct Mesh {
 	Vertex* m_vertexData = nullptr;
 	uint32_t m_vertexCount = 0;
 
-	uint16_t* m_indices = nullptr;
+	uint32_t* m_indices = nullptr;
 	uint32_t m_indicesCount = 0;
 
+	// the box and the sphere around the vertices, in the mesh's own space, see updateBounds.
+	Vec3 m_boundsMin;
+	Vec3 m_boundsMax;
+	Vec3 m_boundsCenter;
+	float m_boundsRadius = 0;
+
+	bool m_doubleSided = false; // seen from both sides, so its back faces are not culled (neither by cullBackFaces nor by the gpu).
+
 	Mesh() {
 	}
 
+	// finds the box and the sphere around the vertices, has to be called when the vertices change. The sphere is centred on the box, which is
+	// not the smallest sphere but is never far off for the meshes here.
+	void updateBounds() {
+		if (0 == m_vertexCount) {
+			m_boundsMin = m_boundsMax = m_boundsCenter = Vec3();
+			m_boundsRadius = 0;
+			return;
+		}
+
+		m_boundsMin = m_boundsMax = m_vertexData[0].pos;
+		for (uint32_t index = 1; index < m_vertexCount; index++) {
+			const Vec3& pos = m_vertexData[index].pos;
+			m_boundsMin = { std::min(m_boundsMin.x, pos.x), std::min(m_boundsMin.y, pos.y), std::min(m_boundsMin.z, pos.z) };
+			m_boundsMax = { std::max(m_boundsMax.x, pos.x), std::max(m_boundsMax.y, pos.y), std::max(m_boundsMax.z, pos.z) };
+		}
+
+		m_boundsCenter = { (m_boundsMin.x + m_boundsMax.x) / 2, (m_boundsMin.y + m_boundsMax.y) / 2, (m_boundsMin.z + m_boundsMax.z) / 2 };
+		m_boundsRadius = 0;
+		for (uint32_t index = 0; index < m_vertexCount; index++) {
+			m_boundsRadius = std::max(m_boundsRadius, (m_vertexData[index].pos - m_boundsCenter).abs());
+		}
+	}
+
 	~Mesh() {
 		if (nullptr != m_vertexData) {
 			delete[] m_vertexData;
@@ -78,7 +110,7 @@ struct Mesh {
 		std::string line;
 
 		std::vector<Vertex> verticesLoaded;
-		std::vector<uint16_t> indicesLoaded;
+		std::vector<uint32_t> indicesLoaded;
 
 		while (std::getline(inputFile, line)) {
 			if ('v' == line[0]) {
@@ -117,7 +149,7 @@ struct Mesh {
 		}
 
 		m_vertexData = new Vertex[m_vertexCount];
-		m_indices = new uint16_t[m_indicesCount];
+		m_indices = new uint32_t[m_indicesCount];
 
 		for (int index = 0; index < m_vertexCount; index++) {
 			m_vertexData[index] = verticesLoaded[index];
@@ -127,12 +159,15 @@ struct Mesh {
 			m_indices[index] = indicesLoaded[index];
 		}
 
+		updateBounds();
+
 	}
 
 };
 
 struct GameObject {
 	Mesh* mesh;
+	Mat4 m_transform; // where the mesh is relative to the camera, the mesh's own vertices are never changed.
 
 	void shiftMesh(float x, float y, float z) {
 		shiftNRot(x, y, z, 0, 0);
@@ -142,42 +177,33 @@ struct GameObject {
 		shiftNRot(0, 0, 0, spinAlongY, spinAlongX);
 	}
 
+	// shifts the object, then spins it around the camera along y and then along x.
 	void shiftNRot(float xShift, float yShift, float zShift, float spinAlongY, float spinAlongX) {
-		for (int index = 0; index < mesh->m_vertexCount; index++) {
-			float x = mesh->m_vertexData[index].pos[0] + xShift;
-			float y = mesh->m_vertexData[index].pos[1] + yShift;
-			float z = mesh->m_vertexData[index].pos[2] + zShift;
-
-			mesh->m_vertexData[index].pos[0] = x * cosf(spinAlongY) + z * sinf(spinAlongY);
-			mesh->m_vertexData[index].pos[1] = y;
-			mesh->m_vertexData[index].pos[2] = z * cosf(spinAlongY) - x * sinf(spinAlongY);
-
-			y = mesh->m_vertexData[index].pos[1];
-			z = mesh->m_vertexData[index].pos[2];
-
-			mesh->m_vertexData[index].pos[1] = y * cosf(spinAlongX) - z * sinf(spinAlongX);
-			mesh->m_vertexData[index].pos[2] = z * cosf(spinAlongX) + y * sinf(spinAlongX);
-		}
+		m_transform = Mat4::rotationX(spinAlongX) * Mat4::rotationY(spinAlongY) * Mat4::translation(xShift, yShift, zShift) * m_transform;
 	}
 
-	void addToBuffer(std::vector<Vertex>& vertex, std::vector<uint16_t>& indices) {
-		int16_t currentBufferAmount = vertex.size();
+	// adds the transformed vertices and the indices to the buffers, for geometry that is worked on by the cpu every frame.
+	void addToBuffer(std::vector<Vertex>& vertex, std::vector<uint32_t>& indices) {
+		uint32_t currentBufferAmount = (uint32_t)vertex.size();
 		for (int index = 0; index < mesh->m_indicesCount; index++) {
 			indices.push_back(mesh->m_indices[index] + currentBufferAmount);
 		}
 
 		for (int index = 0; index < mesh->m_vertexCount; index++) {
-			vertex.push_back(mesh->m_vertexData[index]);
+			Vertex someVertex = mesh->m_vertexData[index];
+			someVertex.pos = m_transform.transformPoint(someVertex.pos);
+			vertex.push_back(someVertex);
 		}
 
 	}
 
-	void addToBufferNoIndex(std::vector<Vertex>& vertex, std::vector<uint16_t>& indices) {
-		int16_t currentBufferAmount = vertex.size();
+	void addToBufferNoIndex(std::vector<Vertex>& vertex, std::vector<uint32_t>& indices) {
+		uint32_t currentBufferAmount = (uint32_t)vertex.size();
 		for (int index = 0; index < mesh->m_indicesCount; index++) {
-			vertex.push_back(mesh->m_vertexData[mesh->m_indices[index]]);
+			Vertex someVertex = mesh->m_vertexData[mesh->m_indices[index]];
+			someVertex.pos = m_transform.transformPoint(someVertex.pos);
+			vertex.push_back(someVertex);
 			indices.push_back(currentBufferAmount + index);
 		}
 	}
 };
-
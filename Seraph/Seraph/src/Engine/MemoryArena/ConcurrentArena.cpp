@@ -0,0 +1,135 @@
+#include "ConcurrentArena.h"
+#include "CommonIncludes.h"
+#include <atomic>
+
+static std::atomic<unsigned long long> nextArenaId = 1;
+
+// the last cache that the thread used, so finding the cache is a single compare unless the thread switches between arenas.
+struct LastThreadCache {
+	unsigned long long arenaId = 0;
+	void* cache = nullptr;
+};
+static thread_local LastThreadCache lastThreadCache;
+
+ConcurrentArena::ConcurrentArena(DataBlockSizeType initialSize, DataBlockSizeType reservedSize) : m_backing(initialSize, reservedSize) {
+	m_arenaId = nextArenaId++;
+}
+
+ConcurrentArena::~ConcurrentArena() {}
+
+unsigned int ConcurrentArena::classIndex(DataBlockSizeType dataSizeInBytes) {
+	unsigned int index = 0;
+	DataBlockSizeType classSize = minClassSize;
+	while (classSize < dataSizeInBytes) {
+		classSize <<= 1;
+		index++;
+	}
+	return index;
+}
+
+ConcurrentArena::ThreadCache& ConcurrentArena::threadCache() {
+	if (lastThreadCache.arenaId == m_arenaId) {
+		return *(ThreadCache*)lastThreadCache.cache;
+	}
+
+	std::lock_guard<std::mutex> lock(m_threadCachesMutex);
+	std::thread::id self = std::this_thread::get_id();
+
+	ThreadCache* cache = nullptr;
+	for (std::unique_ptr<ThreadCache>& someCache : m_threadCaches) {
+		if (someCache->owner == self) {
+			cache = someCache.get();
+			break;
+		}
+	}
+	if (nullptr == cache) {
+		m_threadCaches.push_back(std::make_unique<ThreadCache>());
+		cache = m_threadCaches.back().get();
+		cache->owner = self;
+	}
+
+	lastThreadCache.arenaId = m_arenaId;
+	lastThreadCache.cache = cache;
+	return *cache;
+}
+
+void ConcurrentArena::refillBin(std::vector<DataBlockCodeType>& bin, unsigned int classIndex) {
+	std::unique_lock<std::shared_mutex> lock(m_backingMutex);
+	for (unsigned int index = 0; index < refillCount; index++) {
+		bin.push_back(m_backing.allocateData(minClassSize << classIndex));
+	}
+}
+
+void ConcurrentArena::flushBin(std::vector<DataBlockCodeType>& bin, size_t keepCount) {
+	std::unique_lock<std::shared_mutex> lock(m_backingMutex);
+	while (bin.size() > keepCount) {
+		m_backing.deallocateData(bin.back());
+		bin.pop_back();
+	}
+}
+
+DataBlockCodeType ConcurrentArena::allocateData(DataBlockSizeType dataSizeInBytes) {
+	if (dataSizeInBytes > maxClassSize()) {
+		std::unique_lock<std::shared_mutex> lock(m_backingMutex);
+		return m_backing.allocateData(dataSizeInBytes);
+	}
+
+	unsigned int index = classIndex(dataSizeInBytes);
+	std::vector<DataBlockCodeType>& bin = threadCache().bins[index];
+	if (bin.empty()) {
+		refillBin(bin, index);
+	}
+
+	DataBlockCodeType code = bin.back();
+	bin.pop_back();
+	return code;
+}
+
+void ConcurrentArena::deallocateData(DataBlockCodeType dataBlockCode) {
+	DataBlockSizeType blockSize;
+	{
+		std::shared_lock<std::shared_mutex> lock(m_backingMutex);
+		DataBlock* block = (DataBlock*)m_backing.getBlockAddress(dataBlockCode);
+		if (nullptr == block) {
+			return;
+		}
+		blockSize = block->blockSize;
+	}
+
+	if (blockSize > maxClassSize()) {
+		std::unique_lock<std::shared_mutex> lock(m_backingMutex);
+		m_backing.deallocateData(dataBlockCode);
+		return;
+	}
+
+	// every block up to maxClassSize was handed out by a thread cache, so its size is exactly a size class.
+	std::vector<DataBlockCodeType>& bin = threadCache().bins[classIndex(blockSize)];
+	bin.push_back(dataBlockCode);
+	if (bin.size() >= 2 * refillCount) {
+		flushBin(bin, refillCount);
+	}
+}
+
+void* ConcurrentArena::getDataAddress(DataBlockCodeType dataBlockCode) {
+	std::shared_lock<std::shared_mutex> lock(m_backingMutex);
+	return m_backing.getDataAddress(dataBlockCode);
+}
+
+void ConcurrentArena::flushThreadCache() {
+	ThreadCache& cache = threadCache();
+	for (std::vector<DataBlockCodeType>& bin : cache.bins) {
+		if (!bin.empty()) {
+			flushBin(bin, 0);
+		}
+	}
+}
+
+DataBlockSizeType ConcurrentArena::getSize() {
+	std::shared_lock<std::shared_mutex> lock(m_backingMutex);
+	return m_backing.getSize();
+}
+
+DataBlockSizeType ConcurrentArena::getUsedSize() {
+	std::shared_lock<std::shared_mutex> lock(m_backingMutex);
+	return m_backing.getUsedSize();
+}
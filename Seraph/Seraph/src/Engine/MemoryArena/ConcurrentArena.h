@@ -0,0 +1,72 @@
+#pragma once
+#include "MemoryArena.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+// A Memory Arena that can be used from many threads at once.
+// Every thread gets its own cache of free blocks (one list per size class), so most allocations and deallocations never touch shared state.
+// When a cache runs dry it is refilled in a batch from a shared backing MemoryArena, and when it holds too many blocks half of them are given back in a batch,
+// so the lock of the backing arena is only taken once every refillCount operations (the same idea as the front-ends of tcmalloc and mimalloc).
+// The backing arena uses arenaGrowthReserve, so the address of a block never changes while other threads are using it.
+class ConcurrentArena {
+public:
+
+	static constexpr DataBlockSizeType minClassSize = 8; // the smallest size class, smaller allocations are rounded up to it.
+	static constexpr unsigned int classCount = sizeof(DataBlockSizeType) >= 4 ? 10 : 6; // size classes 8, 16, 32 ... (up to 4 kb, or 256 bytes for 16 bit arenas).
+	static constexpr unsigned int refillCount = 32; // blocks that are moved between a thread cache and the backing arena at a time.
+
+	ConcurrentArena(DataBlockSizeType initSize, DataBlockSizeType reservedSize);
+
+	// Deconstructor, the blocks in the thread caches are freed together with the backing arena.
+	~ConcurrentArena();
+
+	ConcurrentArena(const ConcurrentArena&) = delete;
+	ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+
+	// the largest size that is served from the thread caches, bigger allocations go straight to the backing arena.
+	static DataBlockSizeType maxClassSize() {
+		return minClassSize << (classCount - 1);
+	}
+
+	// same as MemoryArena::allocateData, small sizes are rounded up to their size class.
+	DataBlockCodeType allocateData(DataBlockSizeType dataSizeInBytes);
+
+	// same as MemoryArena::deallocateData, except that a block that goes back to a thread cache keeps its code until the cache gives it back to the backing arena
+	// (so a stale code is only detected once that has happened).
+	void deallocateData(DataBlockCodeType dataBlockCode);
+
+	void* getDataAddress(DataBlockCodeType dataBlockCode);
+
+	// gives every block in the cache of the calling thread back to the backing arena, a thread should call this before it exits.
+	void flushThreadCache();
+
+	DataBlockSizeType getSize();
+	DataBlockSizeType getUsedSize(); // includes the blocks that are held by the thread caches.
+
+private:
+
+	struct ThreadCache {
+		std::thread::id owner;
+		std::vector<DataBlockCodeType> bins[classCount]; // free blocks of each size class
+	};
+
+	MemoryArena m_backing;
+	std::shared_mutex m_backingMutex; // taken exclusively to allocate or deallocate in m_backing, and shared to look a code up.
+
+	std::vector<std::unique_ptr<ThreadCache>> m_threadCaches;
+	std::mutex m_threadCachesMutex;
+
+	unsigned long long m_arenaId; // unique for every arena that was created, so a thread never uses the cache of a destroyed arena that had the same address.
+
+	// returns the cache of the calling thread, creating it if needed.
+	ThreadCache& threadCache();
+
+	// returns the index of the size class that the size is rounded up to.
+	static unsigned int classIndex(DataBlockSizeType dataSizeInBytes);
+
+	void refillBin(std::vector<DataBlockCodeType>& bin, unsigned int classIndex);
+	void flushBin(std::vector<DataBlockCodeType>& bin, size_t keepCount);
+};
@@ -0,0 +1,134 @@
+#include "DataBlockFreeList.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+DataBlockFreeList::DataBlockFreeList() {
+	for (unsigned int index = 0; index < binCount; index++) {
+		m_bins[index] = 0;
+	}
+}
+
+DataBlockFreeList& DataBlockFreeList::operator=(DataBlockFreeList&& rhs) {
+	if (this != &rhs) {
+		for (unsigned int index = 0; index < binCount; index++) {
+			m_bins[index] = rhs.m_bins[index];
+			rhs.m_bins[index] = 0;
+		}
+		m_binMap = rhs.m_binMap;
+		rhs.m_binMap = 0;
+	}
+	return *this;
+}
+
+DataBlockFreeList::~DataBlockFreeList() {}
+
+unsigned int DataBlockFreeList::binIndex(DataBlockSizeType blockSize) {
+	unsigned long long value = blockSize;
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+void DataBlockFreeList::addBlock(DataBlockTable& table, DataBlockCodeType blockIndex) {
+	DataBlockSizeType blockSize = table.block(blockIndex).blockSize;
+	if (0 == blockSize) {
+		return;
+	}
+
+	unsigned int bin = binIndex(blockSize);
+	DataBlockCodeType first = m_bins[bin];
+
+	table.prevFreeBlock(blockIndex) = 0;
+	table.nextFreeBlock(blockIndex) = first;
+	if (0 != first) {
+		table.prevFreeBlock(first) = blockIndex;
+	}
+	m_bins[bin] = blockIndex;
+	m_binMap |= 1ull << bin;
+}
+
+void DataBlockFreeList::removeBlock(DataBlockTable& table, DataBlockCodeType blockIndex) {
+	DataBlockSizeType blockSize = table.block(blockIndex).blockSize;
+	if (0 == blockSize) {
+		return;
+	}
+
+	unsigned int bin = binIndex(blockSize);
+	DataBlockCodeType prev = table.prevFreeBlock(blockIndex);
+	DataBlockCodeType next = table.nextFreeBlock(blockIndex);
+
+	if (0 != prev) {
+		table.nextFreeBlock(prev) = next;
+	} else {
+		m_bins[bin] = next;
+	}
+	if (0 != next) {
+		table.prevFreeBlock(next) = prev;
+	}
+	table.prevFreeBlock(blockIndex) = 0;
+	table.nextFreeBlock(blockIndex) = 0;
+
+	if (0 == m_bins[bin]) {
+		m_binMap &= ~(1ull << bin);
+	}
+}
+
+DataBlockCodeType DataBlockFreeList::findSpaceForAllocation(DataBlockTable& table, DataBlockSizeType blockSize) {
+	if (0 == blockSize) {
+		blockSize = 1;
+	}
+
+	unsigned int sizeBin = binIndex(blockSize);
+	bool powerOfTwo = 0 == (blockSize & (blockSize - 1));
+	unsigned int firstBin = powerOfTwo ? sizeBin : sizeBin + 1; // every block in this bin (or higher) is big enough.
+
+	if (firstBin < binCount) {
+		unsigned long long bigEnough = m_binMap & (~0ull << firstBin);
+		if (0 != bigEnough) {
+#ifdef _MSC_VER
+			unsigned long bin;
+			_BitScanForward64(&bin, bigEnough);
+#else
+			unsigned int bin = __builtin_ctzll(bigEnough);
+#endif
+			return m_bins[bin];
+		}
+	}
+
+	if (!powerOfTwo) {
+		for (DataBlockCodeType current = m_bins[sizeBin]; 0 != current; current = table.nextFreeBlock(current)) {
+			if (table.block(current).blockSize >= blockSize) {
+				return current;
+			}
+		}
+	}
+
+	return 0;
+}
+
+DataBlockSizeType DataBlockFreeList::largestBlockSize(DataBlockTable& table) {
+	if (0 == m_binMap) {
+		return 0;
+	}
+
+#ifdef _MSC_VER
+	unsigned long bin;
+	_BitScanReverse64(&bin, m_binMap);
+#else
+	unsigned int bin = 63 - __builtin_clzll(m_binMap);
+#endif
+
+	DataBlockSizeType largest = 0;
+	for (DataBlockCodeType current = m_bins[bin]; 0 != current; current = table.nextFreeBlock(current)) {
+		if (table.block(current).blockSize > largest) {
+			largest = table.block(current).blockSize;
+		}
+	}
+	return largest;
+}
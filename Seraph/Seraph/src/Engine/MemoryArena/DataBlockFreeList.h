@@ -0,0 +1,41 @@
+#pragma once
+
+#include "DataBlockTable.h"
+#include "DataBlockTypes.h"
+
+// Segregated free lists, that index only the unused dataBlocks of the Memory Arena by size.
+// Bin i holds the unused blocks whose size is in [2^i, 2^(i+1)), and a bitmap records which bins are non-empty,
+// so finding a block that is big enough is a couple of bit scans instead of a walk over every block in the arena.
+// Each bin is a doubly linked list of block indices, the links are stored in the block table (prevFreeBlock/nextFreeBlock), so the lists never allocate.
+class DataBlockFreeList {
+public:
+
+	static constexpr unsigned int binCount = sizeof(DataBlockSizeType) * 8;
+
+	DataBlockFreeList();
+	DataBlockFreeList& operator=(DataBlockFreeList&& rhs);
+
+	// Deconstructor, no special purpose as the lists are stored in the block table.
+	~DataBlockFreeList();
+
+	// adds an unused block to the bin of its size (blocks of size 0 are not added).
+	void addBlock(DataBlockTable& table, DataBlockCodeType blockIndex);
+
+	// removes the block from its bin, the block must be in the free list (or have a size of 0).
+	// This must be called before the size of the block is changed, as the size decides which bin the block is in.
+	void removeBlock(DataBlockTable& table, DataBlockCodeType blockIndex);
+
+	// Finds an unused block of at least the given size, returns its index or 0 if there is none.
+	// Bins that only hold blocks that are big enough are checked first (O(1)), then the bin that the size itself falls in is searched.
+	DataBlockCodeType findSpaceForAllocation(DataBlockTable& table, DataBlockSizeType blockSize);
+
+	// returns the size of the largest unused block, 0 if there are none. Only the highest bin that is not empty is searched.
+	DataBlockSizeType largestBlockSize(DataBlockTable& table);
+
+private:
+
+	DataBlockCodeType m_bins[binCount]; // the first block of each bin, 0 if the bin is empty.
+	unsigned long long m_binMap = 0; // bit i is set when bin i is not empty.
+
+	static unsigned int binIndex(DataBlockSizeType blockSize); // rounded-down log base 2 of the size
+};
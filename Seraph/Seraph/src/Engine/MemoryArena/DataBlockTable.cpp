@@ -0,0 +1,72 @@
+#include "DataBlockTable.h"
+#include "CommonIncludes.h"
+
+DataBlockTable::DataBlockTable() {
+	// index 0 is reserved so that no code is ever 0, and so that 0 can mean "no block".
+	m_blocks.push_back(DataBlock());
+	m_states.push_back(BlockState());
+}
+
+DataBlockTable::~DataBlockTable() {}
+
+DataBlockCodeType DataBlockTable::addBlock(DataBlockSizeType blockOffset, DataBlockSizeType blockSize) {
+	DataBlockCodeType index = m_removedBlock;
+
+	if (0 != index) {
+		m_removedBlock = m_states[index].nextFree;
+		m_removedCount--;
+	} else {
+		if (m_blocks.size() > indexMask) {
+			throwError("The block table of the Memory Arena is full.", logLevelError);
+		}
+		index = (DataBlockCodeType)(m_blocks.size());
+		m_blocks.push_back(DataBlock());
+		m_states.push_back(BlockState());
+	}
+
+	DataBlock& someBlock = m_blocks[index];
+	someBlock.blockOffset = blockOffset;
+	someBlock.blockSize = blockSize;
+	someBlock.prevBlock = 0;
+	someBlock.nextBlock = 0;
+	m_states[index].prevFree = 0;
+	m_states[index].nextFree = 0;
+
+	return index;
+}
+
+void DataBlockTable::removeBlock(DataBlockCodeType blockIndex) {
+	BlockState& state = m_states[blockIndex];
+	state.nextFree = m_removedBlock;
+	m_removedBlock = blockIndex;
+	m_removedCount++;
+}
+
+DataBlockCodeType DataBlockTable::useBlock(DataBlockCodeType blockIndex) {
+	BlockState& state = m_states[blockIndex];
+	state.generation |= usedFlag;
+	m_liveCount++;
+
+	return (DataBlockCodeType)(((state.generation & ~usedFlag) << indexBits) | blockIndex);
+}
+
+void DataBlockTable::releaseBlock(DataBlockCodeType blockIndex) {
+	BlockState& state = m_states[blockIndex];
+	DataBlockCodeType generation = state.generation & ~usedFlag;
+
+	state.generation = (generation == maxGeneration) ? 1 : generation + 1; // generation 0 is skipped so that codes stay non-zero.
+	m_liveCount--;
+}
+
+DataBlockCodeType DataBlockTable::findBlock(DataBlockCodeType someCode) {
+	DataBlockCodeType index = slotIndex(someCode);
+
+	if (0 == index || index >= m_blocks.size()) {
+		return 0;
+	}
+
+	if (m_states[index].generation != (slotGeneration(someCode) | usedFlag)) {
+		return 0; // stale, or the block is not used.
+	}
+	return index;
+}
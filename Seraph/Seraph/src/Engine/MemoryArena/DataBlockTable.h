@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "DataBlock.h"
+#include "DataBlockTypes.h"
+
+// The block table stores every dataBlock of the Memory Arena (used and unused) in a dense array, and maps a block code straight to its dataBlock,
+// so resolving a code is a single array load.
+// A block code packs the index of the block into its low bits and the generation of the block into its high bits. When a code is removed, the generation of its block is bumped,
+// so an old (stale) code that points to a reused block is detected and treated as unknown.
+// Index 0 is never handed out and generations start at 1, so a valid code is never 0.
+// Besides the dataBlock, each index has a small state (its generation, whether it is used, and its links in the free list) that is kept in a second array, as it is not needed to find the data.
+class DataBlockTable {
+public:
+
+	static constexpr unsigned int indexBits = sizeof(DataBlockCodeType) * 8 * 3 / 4; // 3/4 of the code is used for the index, the rest for the generation.
+	static constexpr DataBlockCodeType indexMask = (DataBlockCodeType)(((DataBlockCodeType)1 << indexBits) - 1);
+	static constexpr DataBlockCodeType maxGeneration = (DataBlockCodeType)((DataBlockCodeType)~(DataBlockCodeType)0 >> indexBits);
+
+	DataBlockTable();
+	DataBlockTable(DataBlockTable&& rhs) = default;
+	DataBlockTable& operator=(DataBlockTable&& rhs) = default;
+
+	// Deconstructor, no special purpose as the blocks are stored by value.
+	~DataBlockTable();
+
+	// Stores a new unused block and returns its index. This can move every dataBlock, so references to blocks must be looked up again afterwards.
+	DataBlockCodeType addBlock(DataBlockSizeType blockOffset, DataBlockSizeType blockSize);
+
+	// Frees the index of an unused block, so it can be reused by addBlock.
+	void removeBlock(DataBlockCodeType blockIndex);
+
+	// Marks the block as used and returns the code that now identifies it.
+	DataBlockCodeType useBlock(DataBlockCodeType blockIndex);
+
+	// Marks the block as unused, any copies of its code become stale.
+	void releaseBlock(DataBlockCodeType blockIndex);
+
+	// returns the index of the used block with the input code, returns 0 if the code is unknown or stale.
+	DataBlockCodeType findBlock(DataBlockCodeType someCode);
+
+	DataBlock& block(DataBlockCodeType blockIndex) {
+		return m_blocks[blockIndex];
+	}
+
+	bool isUsed(DataBlockCodeType blockIndex) {
+		return 0 != (m_states[blockIndex].generation & usedFlag);
+	}
+
+	// the links of an unused block in its free list (see DataBlockFreeList), 0 is the end of the list.
+	DataBlockCodeType& prevFreeBlock(DataBlockCodeType blockIndex) {
+		return m_states[blockIndex].prevFree;
+	}
+
+	DataBlockCodeType& nextFreeBlock(DataBlockCodeType blockIndex) {
+		return m_states[blockIndex].nextFree;
+	}
+
+	// the maximum number of blocks (used and unused) that can exist at the same time.
+	static unsigned long long maxBlockCount() {
+		return indexMask;
+	}
+
+	// the number of codes that are currently alive (used blocks).
+	unsigned long long liveBlockCount() {
+		return m_liveCount;
+	}
+
+	// the number of blocks (used and unused).
+	unsigned long long blockCount() {
+		return m_blocks.size() - 1 - m_removedCount;
+	}
+
+	// the metadata that every block costs, in bytes.
+	static constexpr size_t bytesPerBlock() {
+		return sizeof(DataBlock) + sizeof(BlockState);
+	}
+
+private:
+
+	// the generation field also holds a flag that marks used blocks, generations never get as high as the flag.
+	static constexpr DataBlockCodeType usedFlag = (DataBlockCodeType)((DataBlockCodeType)1 << (sizeof(DataBlockCodeType) * 8 - 1));
+
+	struct BlockState {
+		DataBlockCodeType generation = 1;
+		DataBlockCodeType prevFree = 0;
+		DataBlockCodeType nextFree = 0; // for removed indices this links the list of indices that addBlock can reuse.
+	};
+
+	std::vector<DataBlock> m_blocks;
+	std::vector<BlockState> m_states;
+	DataBlockCodeType m_removedBlock = 0; // the first removed index, 0 if there are none (the arrays then grow).
+	unsigned long long m_removedCount = 0;
+	unsigned long long m_liveCount = 0;
+
+	static DataBlockCodeType slotIndex(DataBlockCodeType someCode) {
+		return someCode & indexMask;
+	}
+
+	static DataBlockCodeType slotGeneration(DataBlockCodeType someCode) {
+		return (DataBlockCodeType)(someCode >> indexBits);
+	}
+};
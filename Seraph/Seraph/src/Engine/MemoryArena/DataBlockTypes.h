@@ -1,5 +1,21 @@
 #pragma once
 
+// The width (in bits) of the types used by the Memory Arena. It decides how large the arena can get (and how many blocks it can hold):
+// 16 bits limits the arena to 65 kb, 32 bits to 4 gb and 64 bits is effectively unlimited.
+// It can be set by defining SERAPH_MEMORY_ARENA_WIDTH in the project settings (it must be the same for every file), it is 32 by default.
+#ifndef SERAPH_MEMORY_ARENA_WIDTH
+#define SERAPH_MEMORY_ARENA_WIDTH 32
+#endif
+
+#if SERAPH_MEMORY_ARENA_WIDTH == 16
 #define DataBlockCodeType unsigned short // This is saved as a hash define, because the type is not decided on.
-#define DataBlockSizeType unsigned short // it is also assumed that more than 65k bytes will not be used, so an unsigned short is used, 
-										 // but it can easily be changed from the file
\ No newline at end of file
+#define DataBlockSizeType unsigned short
+#elif SERAPH_MEMORY_ARENA_WIDTH == 32
+#define DataBlockCodeType unsigned int
+#define DataBlockSizeType unsigned int
+#elif SERAPH_MEMORY_ARENA_WIDTH == 64
+#define DataBlockCodeType unsigned long long
+#define DataBlockSizeType unsigned long long
+#else
+#error "SERAPH_MEMORY_ARENA_WIDTH must be 16, 32 or 64."
+#endif
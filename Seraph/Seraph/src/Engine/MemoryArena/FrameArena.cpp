@@ -0,0 +1,70 @@
+#include "FrameArena.h"
+#include "CommonIncludes.h"
+
+FrameArena::FrameArena(size_t bytesPerFrame, unsigned int frameCount) {
+	if (0 == frameCount) {
+		frameCount = 1;
+	}
+	m_frames.resize(frameCount);
+	for (FrameBuffer& frame : m_frames) {
+		frame.data = new char[bytesPerFrame];
+		frame.size = bytesPerFrame;
+	}
+}
+
+FrameArena::~FrameArena() {
+	for (FrameBuffer& frame : m_frames) {
+		resetFrame(frame);
+		delete[] frame.data;
+	}
+}
+
+void FrameArena::resetFrame(FrameBuffer& frame) {
+	for (void* pointer : frame.overflow) {
+		::operator delete(pointer);
+	}
+	frame.overflow.clear(); // keeps its capacity, so it does not allocate again next time.
+}
+
+void FrameArena::beginFrame() {
+	if (m_requestedSize > m_frames[m_currentFrame].peakSize) {
+		m_frames[m_currentFrame].peakSize = m_requestedSize;
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+	FrameBuffer& frame = m_frames[m_currentFrame];
+	resetFrame(frame);
+
+	// every buffer is grown to the biggest frame seen so far, with some headroom, so the frames after an overflow fit again.
+	size_t neededSize = 0;
+	for (FrameBuffer& someFrame : m_frames) {
+		if (someFrame.peakSize > neededSize) {
+			neededSize = someFrame.peakSize;
+		}
+	}
+	if (neededSize > frame.size) {
+		delete[] frame.data;
+		frame.size = neededSize + neededSize / 2;
+		frame.data = new char[frame.size];
+	}
+
+	m_offset = 0;
+	m_requestedSize = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	FrameBuffer& frame = m_frames[m_currentFrame];
+
+	size_t start = (m_offset + alignment - 1) & ~(alignment - 1);
+	m_requestedSize += start - m_offset + size;
+
+	if (start + size <= frame.size) {
+		m_offset = start + size;
+		return frame.data + start;
+	}
+
+	m_overflowCount++;
+	void* pointer = ::operator new(size < alignment ? alignment : size); // operator new is aligned to max_align_t, which is all the vertex data needs.
+	frame.overflow.push_back(pointer);
+	return pointer;
+}
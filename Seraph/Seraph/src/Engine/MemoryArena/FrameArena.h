@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// A linear (bump) allocator for data that only lives for a frame or two.
+// It holds one buffer per frame in flight, allocating moves a pointer forward in the buffer of the current frame, and beginFrame frees everything
+// that was allocated in the buffer it switches to by resetting that pointer. So nothing is freed one by one, and a frame makes no heap allocations once the buffers are big enough.
+// Data allocated in a frame stays valid until the same buffer is used again, frameCount frames later (which keeps it alive while the gpu may still read it).
+class FrameArena {
+public:
+
+	FrameArena(size_t bytesPerFrame = 1 << 20, unsigned int frameCount = 2);
+
+	// frees the buffers and any overflow allocations.
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// switches to the buffer of the next frame and frees everything that was allocated in it.
+	// If the buffer overflowed the last time it was used, it is regrown here to fit, so the overflow does not happen again.
+	void beginFrame();
+
+	// returns space for the size in the buffer of the current frame, aligned to the alignment (which must be a power of 2).
+	// When the buffer is full the space is allocated on the heap instead (and counted by getOverflowCount), so this never fails.
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	// bytes allocated in the current frame.
+	size_t getUsedSize() {
+		return m_offset;
+	}
+
+	size_t getFrameSize() {
+		return m_frames[m_currentFrame].size;
+	}
+
+	// the number of allocations that did not fit in a frame buffer and went to the heap, since the arena was created.
+	unsigned long long getOverflowCount() {
+		return m_overflowCount;
+	}
+
+private:
+
+	struct FrameBuffer {
+		char* data = nullptr;
+		size_t size = 0;
+		size_t peakSize = 0; // the most that was asked of this buffer in one frame, overflow included.
+		std::vector<void*> overflow; // heap allocations made when the buffer was full, freed when the buffer is reset.
+	};
+
+	std::vector<FrameBuffer> m_frames;
+	unsigned int m_currentFrame = 0;
+	size_t m_offset = 0; // the first free byte of the buffer of the current frame.
+	size_t m_requestedSize = 0; // bytes asked of the current frame, including the ones that overflowed.
+	unsigned long long m_overflowCount = 0;
+
+	void resetFrame(FrameBuffer& frame);
+};
+
+// Lets the standard containers allocate from a FrameArena, for example a FrameVector<Vertex> that is filled and thrown away every frame.
+// deallocate does nothing, the memory comes back when the frame buffer is reset, so a container must not outlive its frame buffer.
+template <typename T>
+class FrameAllocator {
+public:
+	using value_type = T;
+
+	FrameAllocator(FrameArena& someArena) : m_arena(&someArena) {}
+
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : m_arena(other.m_arena) {}
+
+	T* allocate(size_t count) {
+		return (T*)m_arena->allocate(count * sizeof(T), alignof(T));
+	}
+
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>& other) const {
+		return m_arena == other.m_arena;
+	}
+
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>& other) const {
+		return m_arena != other.m_arena;
+	}
+
+private:
+	template <typename U>
+	friend class FrameAllocator;
+
+	FrameArena* m_arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
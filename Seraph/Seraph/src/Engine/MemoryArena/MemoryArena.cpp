@@ -1,5 +1,9 @@
 #include "MemoryArena.h"
+#include "VirtualMemory.h"
 #include "CommonIncludes.h"
+#include <limits>
+#include <cstring>
+#include <chrono>
 
 int log_2(int inputValue) {
 	// returns the rounded-up answer of log(x) base 2
@@ -12,159 +16,454 @@ int log_2(int inputValue) {
 	return counter;
 }
 
-MemoryArena::MemoryArena() {
-	MemoryArena(2);
-}
+MemoryArena::MemoryArena() : MemoryArena(2) {}
 
-MemoryArena::MemoryArena(unsigned short initialSize) {
+MemoryArena::MemoryArena(DataBlockSizeType initialSize) {
 	m_arenaSize = initialSize;
 	m_arena = new char[m_arenaSize];
-	m_dataMap = new DataBlockNode();
-	m_dataMap->blockOfData = new DataBlock(initialSize, m_dataMap);
+	m_firstBlock = m_blockTable.addBlock(0, initialSize);
+	m_lastBlock = m_firstBlock;
+	m_freeList.addBlock(m_blockTable, m_firstBlock);
+}
+
+MemoryArena::MemoryArena(DataBlockSizeType initialSize, DataBlockSizeType reservedSize) {
+	if (initialSize > reservedSize) {
+		reservedSize = initialSize;
+	}
+
+	m_growthMode = arenaGrowthReserve;
+	m_reservedSize = VirtualMemory::roundToPages(reservedSize);
+	m_arena = VirtualMemory::reserve(m_reservedSize);
+	if (nullptr == m_arena) {
+		throwError("Failed to reserve the address range of the Memory Arena.", logLevelCritical);
+	}
+
+	m_arenaSize = initialSize;
+	m_committedSize = VirtualMemory::roundToPages(initialSize);
+	if (!VirtualMemory::commit(m_arena, m_committedSize)) {
+		throwError("Failed to commit the memory of the Memory Arena.", logLevelCritical);
+	}
+
+	m_firstBlock = m_blockTable.addBlock(0, initialSize);
+	m_lastBlock = m_firstBlock;
+	m_freeList.addBlock(m_blockTable, m_firstBlock);
 }
 
 MemoryArena& MemoryArena::operator=(MemoryArena&& rhs) {
 	if (this != &rhs) {
 
-		this->counter = rhs.counter;
+		releaseArena();
+
+		this->m_blockTable = std::move(rhs.m_blockTable);
+		this->m_freeList = std::move(rhs.m_freeList);
 		this->m_arenaSize = rhs.m_arenaSize;
+		this->m_usedSize = rhs.m_usedSize;
+		this->m_growthMode = rhs.m_growthMode;
+		this->m_reservedSize = rhs.m_reservedSize;
+		this->m_committedSize = rhs.m_committedSize;
+		this->m_firstBlock = rhs.m_firstBlock;
+		this->m_lastBlock = rhs.m_lastBlock;
+		this->m_compactionBlock = 0;
+		this->m_allocCount = rhs.m_allocCount;
+		this->m_freeCount = rhs.m_freeCount;
+		this->m_frameAllocCount = rhs.m_frameAllocCount;
+		this->m_frameFreeCount = rhs.m_frameFreeCount;
+		this->m_lastFrameAllocCount = rhs.m_lastFrameAllocCount;
+		this->m_lastFrameFreeCount = rhs.m_lastFrameFreeCount;
+		this->m_rebuildCount = rhs.m_rebuildCount;
+		this->m_rebuildMicroseconds = rhs.m_rebuildMicroseconds;
+		this->m_trace = std::move(rhs.m_trace);
 
-		if (this->m_arena != nullptr) {
-			delete[] this->m_arena;
-			this->m_arena = nullptr;
-		}
-		if (this->m_dataMap != nullptr) {
-			this->m_dataMap = m_dataMap->headNode;
-			this->m_dataMap->destroyAllNodes();
-			this->m_dataMap = nullptr;
-		}
 		if (rhs.m_arena != nullptr) {
 			this->m_arena = rhs.m_arena;
 			rhs.m_arena = nullptr;
 		}
-		if (rhs.m_dataMap != nullptr) {
-			this->m_dataMap = rhs.m_dataMap;
-			rhs.m_dataMap = nullptr;
-		}
 	}
 	return *this;
 }
 
 MemoryArena::~MemoryArena() {
-	if (m_arena != nullptr) {
-		delete[] m_arena;
-		m_arena = nullptr;
+	releaseArena();
+}
+
+void MemoryArena::releaseArena() {
+	if (m_arena == nullptr) {
+		return;
+	}
+	switch (m_growthMode) {
+	case arenaGrowthCopy:
+		delete[] (char*)m_arena;
+		break;
+	case arenaGrowthReserve:
+		VirtualMemory::release(m_arena, m_reservedSize);
+		break;
+	}
+	m_arena = nullptr;
+}
+
+DataBlockSizeType MemoryArena::resizedArenaSize(DataBlockSizeType currentSize, float sizeRatio) {
+	const DataBlockSizeType maxSize = std::numeric_limits<DataBlockSizeType>::max();
+	double newSize = (double)currentSize * sizeRatio;
+
+	if (newSize >= (double)maxSize) {
+		return maxSize;
 	}
-	if (m_dataMap != nullptr) {
-		m_dataMap = m_dataMap->headNode;
-		m_dataMap->destroyAllNodes();
-		m_dataMap = nullptr;
+	if (sizeRatio > 1 && newSize < (double)currentSize + 1) {
+		return currentSize + 1; // always grow by at least a byte, so small arenas do not get stuck.
 	}
+	return (DataBlockSizeType)newSize;
+}
+
+DataBlockSizeType MemoryArena::getMaxSize() {
+	const DataBlockSizeType maxSize = std::numeric_limits<DataBlockSizeType>::max();
+	if (arenaGrowthReserve == m_growthMode && m_reservedSize < maxSize) {
+		return (DataBlockSizeType)m_reservedSize;
+	}
+	return maxSize;
 }
 
 /*
 * Changes the size of the array by multipying with some ratio.
   This function is only called to try to keep 50%-75% of the array in use. This will ensure that the array does not get uneccassarily large with little data and also tries to keep space for new data.
+  Space that is added is given to the last block if it is unused (otherwise a new unused block is added at the end), and space can only be removed if the last block is unused and big enough.
+  With arenaGrowthReserve nothing is copied, pages are only committed (or decommitted) at the end of the arena.
 */
 void MemoryArena::rebuildArena(float sizeRatio) {
-	DataBlockSizeType newSize = DataBlockSizeType(m_arenaSize * sizeRatio);
-	void* tempArena = new char[newSize];
-	int min = newSize > m_arenaSize? m_arenaSize : newSize;
-	for (int index = 0; index < min; index++) {
-		((char*)tempArena)[index] = ((char*)m_arena)[index];
+	DataBlockSizeType newSize = resizedArenaSize(m_arenaSize, sizeRatio);
+	if (newSize > getMaxSize()) {
+		newSize = getMaxSize();
+	}
+	if (newSize == m_arenaSize) {
+		return;
+	}
+
+	bool lastBlockUsed = m_blockTable.isUsed(m_lastBlock);
+
+	if (newSize < m_arenaSize) {
+		DataBlockSizeType removedSize = m_arenaSize - newSize;
+		if (lastBlockUsed || m_blockTable.block(m_lastBlock).blockSize <= removedSize) {
+			return;
+		}
+	}
+
+	auto rebuildStart = std::chrono::steady_clock::now();
+
+	switch (m_growthMode) {
+	case arenaGrowthCopy:
+	{
+		void* tempArena = new char[newSize];
+		memcpy(tempArena, m_arena, newSize > m_arenaSize ? m_arenaSize : newSize);
+		delete[] (char*)m_arena;
+		m_arena = tempArena;
+		break;
+	}
+	case arenaGrowthReserve:
+	{
+		size_t newCommittedSize = VirtualMemory::roundToPages(newSize);
+		if (newCommittedSize > m_committedSize) {
+			if (!VirtualMemory::commit((char*)m_arena + m_committedSize, newCommittedSize - m_committedSize)) {
+				throwError("Failed to commit more memory for the Memory Arena.", logLevelError);
+			}
+		} else if (newCommittedSize < m_committedSize) {
+			VirtualMemory::decommit((char*)m_arena + newCommittedSize, m_committedSize - newCommittedSize);
+		}
+		m_committedSize = newCommittedSize;
+		break;
+	}
+	}
+
+	if (!lastBlockUsed) {
+		m_freeList.removeBlock(m_blockTable, m_lastBlock);
+		m_blockTable.block(m_lastBlock).blockSize += newSize - m_arenaSize;
+		m_freeList.addBlock(m_blockTable, m_lastBlock);
+	} else {
+		DataBlockCodeType add = m_blockTable.addBlock(m_arenaSize, newSize - m_arenaSize);
+		m_blockTable.block(add).prevBlock = m_lastBlock;
+		m_blockTable.block(m_lastBlock).nextBlock = add;
+		m_lastBlock = add;
+		m_freeList.addBlock(m_blockTable, add);
 	}
-	
-	delete[] m_arena;
 
 	m_arenaSize = newSize;
-	m_arena = tempArena;
+
+	m_rebuildCount++;
+	m_rebuildMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - rebuildStart).count();
+	if (nullptr != m_trace) {
+		m_trace->record(arenaTraceRebuild, 0, newSize);
+	}
 };
 
+void MemoryArena::trimArena() {
+	const double lowerUse = 0.632; // 1-e^-1
+	const double targetUse = 0.75; // about halfway between 1-e^-1 and 1-e^-2
+
+	if (m_usedSize >= m_arenaSize * lowerUse) {
+		return;
+	}
+
+	DataBlockSizeType targetSize = (DataBlockSizeType)(m_usedSize / targetUse) + 1;
+	if (arenaGrowthReserve == m_growthMode && VirtualMemory::roundToPages(targetSize) >= m_committedSize) {
+		return; // no whole page would be decommitted.
+	}
+	rebuildArena((float)((double)targetSize / m_arenaSize));
+}
+
 /*
 * Takes the input and finds an empty spot in the Arena big enough and returns the dataBlock ID assigned to that space
 */
 DataBlockCodeType MemoryArena::allocateData(DataBlockSizeType dataSizeInBytes)
 {
-	DataBlock* space = (*m_dataMap).findSpaceForAllocation(dataSizeInBytes);
+	DataBlockCodeType space = m_freeList.findSpaceForAllocation(m_blockTable, dataSizeInBytes);
 
-	switch (space == nullptr) {
+	switch (0 == space) {
 	case true:
+		if (arenaGrowthCopy == m_growthMode && m_arenaSize > m_usedSize && m_arenaSize - m_usedSize >= dataSizeInBytes) {
+			// there is enough unused space, it is just split up. Growing would copy the whole arena anyway (and move the data), so the blocks are packed instead.
+			while (compactStep()) {}
+			return allocateData(dataSizeInBytes);
+		}
+		if (m_arenaSize == getMaxSize()) {
+			throwError("The Memory Arena cannot grow any further, reserve a larger range or use a wider SERAPH_MEMORY_ARENA_WIDTH.", logLevelError);
+		}
 		rebuildArena(2);
 		return allocateData(dataSizeInBytes);
 		break;
 	case false:
-		switch (space->blockSize > dataSizeInBytes) {
+		m_freeList.removeBlock(m_blockTable, space);
+		m_usedSize += dataSizeInBytes;
+		switch (m_blockTable.block(space).blockSize > dataSizeInBytes) {
 		case true:
 		{
-			DataBlock* add = new DataBlock(counter++, dataSizeInBytes);
-			add->blockOffset = space->blockOffset + space->blockSize - dataSizeInBytes;
+			// the data is taken from the end of the unused block, so the unused block only shrinks.
+			DataBlock& spaceBlock = m_blockTable.block(space);
+			DataBlockCodeType add = m_blockTable.addBlock(spaceBlock.blockOffset + spaceBlock.blockSize - dataSizeInBytes, dataSizeInBytes);
+			DataBlock& addBlock = m_blockTable.block(add);
+			DataBlock& unusedBlock = m_blockTable.block(space); // looked up again, as adding a block can move the blocks.
 
-			space->nodeList.memArenaList->addDataBlock(add);
-			space->blockSize -= dataSizeInBytes;
-			break;
+			addBlock.prevBlock = space;
+			addBlock.nextBlock = unusedBlock.nextBlock;
+			if (0 != unusedBlock.nextBlock) {
+				m_blockTable.block(unusedBlock.nextBlock).prevBlock = add;
+			} else {
+				m_lastBlock = add;
+			}
+			unusedBlock.nextBlock = add;
+			unusedBlock.blockSize -= dataSizeInBytes;
+			m_freeList.addBlock(m_blockTable, space);
+
+			return recordAllocation(m_blockTable.useBlock(add), dataSizeInBytes);
 		}
 		case false:
 		{
-			space->blockCode = counter++;
-			break;
+			return recordAllocation(m_blockTable.useBlock(space), dataSizeInBytes);
 		}
 		}
-		return counter - 1;
 	}
 }
 
+DataBlockCodeType MemoryArena::recordAllocation(DataBlockCodeType dataBlockCode, DataBlockSizeType dataSizeInBytes) {
+	m_allocCount++;
+	m_frameAllocCount++;
+	if (nullptr != m_trace) {
+		m_trace->record(arenaTraceAllocate, dataBlockCode, dataSizeInBytes);
+	}
+	return dataBlockCode;
+}
+
 bool MemoryArena::isAvailable(DataBlockSizeType dataBlockSize) {
-	return nullptr != (*m_dataMap).findSpaceForAllocation(dataBlockSize);
+	return 0 != m_freeList.findSpaceForAllocation(m_blockTable, dataBlockSize);
 }
 
 /*
-* Takes the input code and finds the datablock in the Arena removes it from the arena. It also removes the dataBlock from all linked lists.
+* Takes the input code and finds the datablock in the Arena and marks it as unused. The block is merged with any unused neighbours, so unused space is never split up.
 */
 void MemoryArena::deallocateData(DataBlockCodeType dataCode) {
-	DataBlockNode* node = (*m_dataMap).findNode(dataCode);
-
-	if (nullptr != node) {
-		DataBlockNode* prev = node->prevNode;
-		DataBlockNode* next = node->nextNode;
-
-		if (node->blockOfData->blockOffset > 0 && nullptr != prev && 0 == prev->blockOfData->blockCode) {
-			node->removeNodeList();
-			prev->blockOfData->blockSize += node->blockOfData->blockSize;
-			if (nullptr != next && next->blockOfData->blockOffset > node->blockOfData->blockOffset && 0 == next->blockOfData->blockCode) {
-				prev->blockOfData->blockSize += next->blockOfData->blockSize;
-				next->removeNodeList();
-				delete next->blockOfData;
-				delete next;
-			}
-			delete node->blockOfData;
-			delete node;
-		} else if (nullptr != next && next->blockOfData->blockOffset > node->blockOfData->blockOffset && 0 == next->blockOfData->blockCode) {
-			node->removeNodeList();
-			next->blockOfData->blockOffset = node->blockOfData->blockOffset;
-			next->blockOfData->blockSize += node->blockOfData->blockSize;
-	
-			delete node->blockOfData;
-			delete node;
-		} else {
-			node->blockOfData->blockCode = 0;
+	DataBlockCodeType blockIndex = m_blockTable.findBlock(dataCode);
+
+	if (0 == blockIndex) {
+		return;
+	}
+
+	m_blockTable.releaseBlock(blockIndex);
+	m_usedSize -= m_blockTable.block(blockIndex).blockSize;
+
+	m_freeCount++;
+	m_frameFreeCount++;
+	if (nullptr != m_trace) {
+		m_trace->record(arenaTraceDeallocate, dataCode, m_blockTable.block(blockIndex).blockSize);
+	}
+
+	DataBlockCodeType prev = m_blockTable.block(blockIndex).prevBlock;
+	if (0 != prev && !m_blockTable.isUsed(prev)) {
+		// this block is merged into the previous one (rather than the other way round), so the first block is never removed.
+		m_freeList.removeBlock(m_blockTable, prev);
+		mergeWithNextBlock(prev);
+		blockIndex = prev;
+	}
+
+	DataBlockCodeType next = m_blockTable.block(blockIndex).nextBlock;
+	if (0 != next && !m_blockTable.isUsed(next)) {
+		m_freeList.removeBlock(m_blockTable, next);
+		mergeWithNextBlock(blockIndex);
+	}
+
+	m_freeList.addBlock(m_blockTable, blockIndex);
+
+	if (0 != m_compactionBlock && m_blockTable.block(blockIndex).blockOffset < m_blockTable.block(m_compactionBlock).blockOffset) {
+		m_compactionBlock = blockIndex; // a hole opened up below where compaction got to, so it has to go back for it.
+	}
+
+	if (arenaGrowthReserve == m_growthMode) {
+		trimArena(); // decommitting pages does not move any data, so it is cheap enough to do here.
+	}
+}
+
+void MemoryArena::mergeWithNextBlock(DataBlockCodeType blockIndex) {
+	DataBlock& someBlock = m_blockTable.block(blockIndex);
+	DataBlockCodeType next = someBlock.nextBlock;
+	DataBlock& nextBlock = m_blockTable.block(next);
+
+	someBlock.blockSize += nextBlock.blockSize;
+	someBlock.nextBlock = nextBlock.nextBlock;
+	if (0 != nextBlock.nextBlock) {
+		m_blockTable.block(nextBlock.nextBlock).prevBlock = blockIndex;
+	} else {
+		m_lastBlock = blockIndex;
+	}
+	if (m_compactionBlock == next) {
+		m_compactionBlock = blockIndex; // the removed block was where compaction got to, it carries on from the block it was merged into.
+	}
+	m_blockTable.removeBlock(next);
+}
+
+bool MemoryArena::compactStep() {
+	DataBlockCodeType unused = (0 != m_compactionBlock) ? m_compactionBlock : m_firstBlock;
+	while (0 != unused && m_blockTable.isUsed(unused)) {
+		unused = m_blockTable.block(unused).nextBlock;
+	}
+	m_compactionBlock = unused;
+
+	if (0 == unused || 0 == m_blockTable.block(unused).nextBlock) {
+		m_compactionBlock = 0;
+		return false; // every used block is packed at the start of the arena.
+	}
+
+	// unused blocks never sit next to each other (they are merged), so the next block is used.
+	DataBlockCodeType used = m_blockTable.block(unused).nextBlock;
+	DataBlock& unusedBlock = m_blockTable.block(unused);
+	DataBlock& usedBlock = m_blockTable.block(used);
+
+	memmove((char*)m_arena + unusedBlock.blockOffset, (char*)m_arena + usedBlock.blockOffset, usedBlock.blockSize);
+	usedBlock.blockOffset = unusedBlock.blockOffset;
+	unusedBlock.blockOffset = usedBlock.blockOffset + usedBlock.blockSize;
+
+	// swap the two blocks in the list: prev, unused, used, next becomes prev, used, unused, next.
+	DataBlockCodeType prev = unusedBlock.prevBlock;
+	DataBlockCodeType next = usedBlock.nextBlock;
+	usedBlock.prevBlock = prev;
+	usedBlock.nextBlock = unused;
+	unusedBlock.prevBlock = used;
+	unusedBlock.nextBlock = next;
+	if (0 != prev) {
+		m_blockTable.block(prev).nextBlock = used;
+	} else {
+		m_firstBlock = used;
+	}
+	if (0 != next) {
+		m_blockTable.block(next).prevBlock = unused;
+	} else {
+		m_lastBlock = unused;
+	}
+
+	if (0 != next && !m_blockTable.isUsed(next)) {
+		m_freeList.removeBlock(m_blockTable, unused);
+		m_freeList.removeBlock(m_blockTable, next);
+		mergeWithNextBlock(unused);
+		m_freeList.addBlock(m_blockTable, unused);
+	}
+	return true;
+}
+
+bool MemoryArena::compactArena(long long budgetMicroseconds) {
+	auto start = std::chrono::steady_clock::now();
+
+	while (compactStep()) {
+		if (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() >= budgetMicroseconds) {
+			return false;
 		}
 	}
+
+	if (arenaGrowthReserve == m_growthMode) {
+		trimArena(); // all the unused space is at the end now, so it can be decommitted.
+	}
+	return true;
+}
+
+float MemoryArena::getFragmentation() {
+	DataBlockSizeType unusedSize = m_arenaSize - m_usedSize;
+	if (0 == unusedSize) {
+		return 0;
+	}
+	return 1.0f - (float)((double)m_freeList.largestBlockSize(m_blockTable) / unusedSize);
 }
 
 void* MemoryArena::getDataAddress(DataBlockCodeType dataBlockCode) {
 
-	DataBlockNode* temp = (*m_dataMap).findNode(dataBlockCode);
-	if (temp == nullptr) {
+	DataBlockCodeType blockIndex = m_blockTable.findBlock(dataBlockCode);
+	if (0 == blockIndex) {
 		return nullptr;
 	}
-	return (char*)m_arena + temp->blockOfData->blockOffset;
+	return (char*)m_arena + m_blockTable.block(blockIndex).blockOffset;
 }
 
 void* MemoryArena::getBlockAddress(DataBlockCodeType dataBlockCode) {
 
-	DataBlockNode* temp = (*m_dataMap).findNode(dataBlockCode);
-	if (temp == nullptr) {
+	DataBlockCodeType blockIndex = m_blockTable.findBlock(dataBlockCode);
+	if (0 == blockIndex) {
 		return nullptr;
 	}
-	return temp->blockOfData;
+	return &m_blockTable.block(blockIndex);
+}
+
+MemoryArenaStats MemoryArena::getStats() {
+	MemoryArenaStats stats;
+	stats.arenaSize = m_arenaSize;
+	stats.liveBytes = m_usedSize;
+	stats.freeBytes = m_arenaSize - m_usedSize;
+	stats.largestFreeBlock = m_freeList.largestBlockSize(m_blockTable);
+	stats.fragmentation = getFragmentation();
+	stats.blockCount = m_blockTable.liveBlockCount();
+	stats.freeBlockCount = m_blockTable.blockCount() - m_blockTable.liveBlockCount();
+	stats.allocCount = m_allocCount;
+	stats.freeCount = m_freeCount;
+	stats.allocsLastFrame = m_lastFrameAllocCount;
+	stats.freesLastFrame = m_lastFrameFreeCount;
+	stats.rebuildCount = m_rebuildCount;
+	stats.rebuildMicroseconds = m_rebuildMicroseconds;
+	return stats;
+}
+
+void MemoryArena::beginFrame() {
+	m_lastFrameAllocCount = m_frameAllocCount;
+	m_lastFrameFreeCount = m_frameFreeCount;
+	m_frameAllocCount = 0;
+	m_frameFreeCount = 0;
+	if (nullptr != m_trace) {
+		m_trace->record(arenaTraceFrame, 0, 0);
+	}
+}
+
+void MemoryArena::enableTrace(size_t recordCount) {
+	m_trace = std::make_unique<MemoryArenaTrace>(recordCount);
+}
+
+void MemoryArena::disableTrace() {
+	m_trace.reset();
+}
+
+bool MemoryArena::dumpTrace(const std::string& filename) {
+	if (nullptr == m_trace) {
+		return false;
+	}
+	return m_trace->dump(filename);
 }
@@ -1,28 +1,97 @@
 #pragma once
-#include "DataBlockNode.h"
+#include "DataBlockTable.h"
+#include "DataBlockFreeList.h"
+#include "MemoryArenaTrace.h"
+#include <memory>
+#include <string>
+
+// Decides what happens to the memory of the arena when it has to grow.
+enum ArenaGrowthMode {
+	arenaGrowthCopy,	// a new, bigger array is allocated and the data is copied over, so addresses returned by getDataAddress change when the arena grows.
+	arenaGrowthReserve	// a range of addresses is reserved up front and pages are committed as the arena grows, so nothing is copied and addresses never change.
+};
+
+// A snapshot of how the arena is being used, returned by MemoryArena::getStats.
+struct MemoryArenaStats {
+	DataBlockSizeType arenaSize = 0;
+	DataBlockSizeType liveBytes = 0; // bytes in used blocks
+	DataBlockSizeType freeBytes = 0; // bytes in unused blocks
+	DataBlockSizeType largestFreeBlock = 0;
+	float fragmentation = 0; // see MemoryArena::getFragmentation
+
+	unsigned long long blockCount = 0; // used blocks (live codes)
+	unsigned long long freeBlockCount = 0; // unused blocks
+
+	unsigned long long allocCount = 0; // since the arena was created
+	unsigned long long freeCount = 0;
+	unsigned long long allocsLastFrame = 0; // in the frame before the last call to beginFrame
+	unsigned long long freesLastFrame = 0;
+
+	unsigned long long rebuildCount = 0; // times the arena was grown or shrunk
+	double rebuildMicroseconds = 0; // time spent in rebuildArena, in total
+};
 
 // Stores and manages data by using blocks and linked lists.
 class MemoryArena {
 private:
-	// it is assumed that the arena will not hold more than 65 kb, so short is used for arena size.
-	
-	// counter that increases for every new datablock, an easy short term solution for a unique code.
-	DataBlockCodeType counter = 1;
+	// the largest size the arena can hold depends on the width of DataBlockSizeType (see DataBlockTypes.h).
 
-	void* m_arena; // Starting location of the Arena
+	// stores every datablock of the arena (used and unused), and maps every block code in use to its datablock.
+	DataBlockTable m_blockTable;
+
+	void* m_arena = nullptr; // Starting location of the Arena
 	DataBlockSizeType m_arenaSize = 1; // Arena size in bytes
+	DataBlockSizeType m_usedSize = 0; // bytes that are in use by allocated blocks
+
+	ArenaGrowthMode m_growthMode = arenaGrowthCopy;
+	size_t m_reservedSize = 0; // size of the reserved range of addresses (arenaGrowthReserve only)
+	size_t m_committedSize = 0; // bytes of the reserved range that are committed, always a whole number of pages (arenaGrowthReserve only)
 	
-	DataBlockNode* m_dataMap; // an array that maps the location of data (using blocks) to a given block code
+	// the blocks are linked in the order of their offsets (DataBlock::prevBlock/nextBlock), starting at the first block and ending at the last block.
+	DataBlockCodeType m_firstBlock = 0;
+	DataBlockCodeType m_lastBlock = 0;
+
+	// indexes the unused blocks of the arena by size, so that allocating does not have to search through every block.
+	DataBlockFreeList m_freeList;
+
+	// counters for getStats
+	unsigned long long m_allocCount = 0;
+	unsigned long long m_freeCount = 0;
+	unsigned long long m_frameAllocCount = 0; // in the current frame
+	unsigned long long m_frameFreeCount = 0;
+	unsigned long long m_lastFrameAllocCount = 0;
+	unsigned long long m_lastFrameFreeCount = 0;
+	unsigned long long m_rebuildCount = 0;
+	double m_rebuildMicroseconds = 0;
+
+	std::unique_ptr<MemoryArenaTrace> m_trace; // nullptr unless tracing is enabled
 
 	// adjusts the size of the Arena by multiplying size with inputted ratio
 	void rebuildArena(float sizeRatio); 
 	
 	// ideally the arrays will be kept to a size such that 63%-86% of the array is in use (those are arbitary numbers I chose, 1-e^-1 and 1-e^-2) 
 
+	// frees the memory of the arena in the way that the growth mode allocated it.
+	void releaseArena();
+
+	// merges the unused block that follows the block into it, and removes the following block. Neither block may be in the free list.
+	void mergeWithNextBlock(DataBlockCodeType blockIndex);
+
+	// the unused block that compaction is moving towards the end of the arena, 0 if compaction has to start again from the first block.
+	DataBlockCodeType m_compactionBlock = 0;
+
+	// moves the used block after the first unused block down into the unused space (the unused block moves up and merges with any unused block after it).
+	// Returns false if there is nothing left to move, because the only unused block is the last block.
+	bool compactStep();
+
+	// counts a finished allocation (and traces it), returns the code.
+	DataBlockCodeType recordAllocation(DataBlockCodeType dataBlockCode, DataBlockSizeType dataSizeInBytes);
+
 public: 
 
 	MemoryArena();
-	MemoryArena(unsigned short initSize);
+	MemoryArena(DataBlockSizeType initSize);
+	MemoryArena(DataBlockSizeType initSize, DataBlockSizeType reservedSize); // uses arenaGrowthReserve, the arena can grow up to reservedSize without moving.
 	MemoryArena& operator=(MemoryArena&& rhs);
 
 	~MemoryArena(); // deletes the Arena and Data block arrays and clears any other neccessary resources
@@ -31,6 +100,46 @@ public:
 		return m_arenaSize;
 	};
 
+	DataBlockSizeType getUsedSize() {
+		return m_usedSize;
+	};
+
+	ArenaGrowthMode getGrowthMode() {
+		return m_growthMode;
+	};
+
+	// the largest size the arena can grow to.
+	DataBlockSizeType getMaxSize();
+
+	// shrinks the arena when less than 63% of it is in use, so that about 75% of it is in use again. 
+	// Only the unused space at the end of the arena can be removed. With arenaGrowthReserve the removed pages are decommitted (this is called by deallocateData),
+	// with arenaGrowthCopy the arena is copied into a smaller array.
+	void trimArena();
+
+
+	// Slides used blocks down to the start of the arena, so the unused space collects into one block at the end, for at most about the given number of microseconds.
+	// Block codes stay valid, but the data of moved blocks changes address, so any pointer from getDataAddress must be looked up again afterwards.
+	// The compaction carries on where it stopped on the next call, so it can be run for a small budget every frame. Returns true once the arena is fully compacted.
+	bool compactArena(long long budgetMicroseconds);
+
+	MemoryArenaStats getStats();
+
+	// ends the frame for the per-frame counters of getStats (and marks the frame in the trace), should be called once at the start of every frame.
+	void beginFrame();
+
+	// starts recording the last recordCount operations of the arena in a ring buffer (a running trace is restarted).
+	void enableTrace(size_t recordCount);
+	void disableTrace();
+
+	// writes the trace to a binary file (see MemoryArenaTrace for the format), returns false if tracing is not enabled or the file could not be written.
+	bool dumpTrace(const std::string& filename);
+
+	// how split up the unused space is, 0 when it is all in one block (or there is none) and close to 1 when it is spread over many small blocks.
+	// It is 1 - (largest unused block / all unused bytes).
+	float getFragmentation();
+
+	// returns the size of the arena after growing (or shrinking) it by the ratio. The size is clamped to what DataBlockSizeType can hold, so it never wraps around.
+	static DataBlockSizeType resizedArenaSize(DataBlockSizeType currentSize, float sizeRatio);
 
 	// below func should be deleted after testing is complete
 	void* getAddress() {
@@ -38,15 +147,16 @@ public:
 	};
 
 
-	// checks to see if there is enough space to add a datablock of the given size to the dataMap
+	// checks to see if there is enough space to add a datablock of the given size to the arena
 	bool isAvailable(DataBlockSizeType dataBlockSize);
 
 	//__int8 addInitialData(unsigned short dataSizeInBytes); // should be used when adding initial data (same as allocateData(), but does not shrink the array)
 
 	DataBlockCodeType allocateData(DataBlockSizeType dataSizeInBytes); // finds a empty space big enough for the data and returns its assigned unique code
 	void deallocateData(DataBlockCodeType dataBlockCode); // finds the data block assossicated with the code and removes it (does not manage memory by deleting object so caller must use delete if new was used)
+														  // the code (and any copy of it) becomes stale, and will not be resolved by the functions below.
 
 	void* getDataAddress(DataBlockCodeType dataBlockCode); // Retrieves the memory address of the data block with input code, but the object is not deallocated (rather use pop).
-	void* getBlockAddress(DataBlockCodeType dataBlockCode); // Retrieves the memory address of the data block with input code, but the object is not deallocated (rather use pop).
+	void* getBlockAddress(DataBlockCodeType dataBlockCode); // Retrieves the address of the dataBlock (the record, not the data) with input code, it is only valid until the next allocation.
 
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "MemoryArenaTrace.h"
+#include <fstream>
+
+// writes the value in little endian, using the given number of bytes.
+static void writeValue(std::ofstream& file, unsigned long long value, unsigned int byteCount) {
+	for (unsigned int index = 0; index < byteCount; index++) {
+		file.put((char)((value >> (index * 8)) & 0xFF));
+	}
+}
+
+static bool readValue(std::ifstream& file, unsigned long long& value, unsigned int byteCount) {
+	value = 0;
+	for (unsigned int index = 0; index < byteCount; index++) {
+		int byte = file.get();
+		if (std::ifstream::traits_type::eof() == byte) {
+			return false;
+		}
+		value |= (unsigned long long)(unsigned char)byte << (index * 8);
+	}
+	return true;
+}
+
+MemoryArenaTrace::MemoryArenaTrace(size_t recordCount) {
+	m_records.resize(recordCount > 0 ? recordCount : 1);
+	m_startTime = std::chrono::steady_clock::now();
+}
+
+MemoryArenaTrace::~MemoryArenaTrace() {}
+
+void MemoryArenaTrace::record(ArenaTraceOp op, DataBlockCodeType code, DataBlockSizeType size) {
+	ArenaTraceRecord& someRecord = m_records[m_next];
+	someRecord.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+	someRecord.code = code;
+	someRecord.size = size;
+	someRecord.op = op;
+
+	m_next = (m_next + 1) % m_records.size();
+	if (m_count < m_records.size()) {
+		m_count++;
+	}
+}
+
+bool MemoryArenaTrace::dump(const std::string& filename) {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	const unsigned int width = sizeof(DataBlockSizeType);
+	file.write("SRAT", 4);
+	writeValue(file, formatVersion, 1);
+	writeValue(file, width, 1);
+	writeValue(file, m_count, 8);
+
+	size_t first = (m_next + m_records.size() - m_count) % m_records.size(); // the oldest record
+	for (size_t index = 0; index < m_count; index++) {
+		ArenaTraceRecord& someRecord = m_records[(first + index) % m_records.size()];
+		writeValue(file, someRecord.op, 1);
+		writeValue(file, someRecord.time, 8);
+		writeValue(file, someRecord.code, width);
+		writeValue(file, someRecord.size, width);
+	}
+
+	return file.good();
+}
+
+bool MemoryArenaTrace::readTrace(const std::string& filename, std::vector<ArenaTraceRecord>& records) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	char magic[4];
+	file.read(magic, 4);
+	unsigned long long version, width, count;
+	if (!file.good() || 0 != std::string(magic, 4).compare("SRAT") || !readValue(file, version, 1) || !readValue(file, width, 1) || !readValue(file, count, 8)) {
+		return false;
+	}
+	if (formatVersion != version || sizeof(DataBlockSizeType) != width) {
+		return false;
+	}
+
+	records.clear();
+	records.reserve(count);
+	for (unsigned long long index = 0; index < count; index++) {
+		unsigned long long op, time, code, size;
+		if (!readValue(file, op, 1) || !readValue(file, time, 8) || !readValue(file, code, (unsigned int)width) || !readValue(file, size, (unsigned int)width)) {
+			return false;
+		}
+		records.push_back({ time, (DataBlockCodeType)code, (DataBlockSizeType)size, (ArenaTraceOp)op });
+	}
+	return true;
+}
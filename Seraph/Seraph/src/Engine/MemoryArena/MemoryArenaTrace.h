@@ -0,0 +1,60 @@
+#pragma once
+#include "DataBlockTypes.h"
+#include <vector>
+#include <string>
+#include <chrono>
+
+// What a trace record describes.
+enum ArenaTraceOp : unsigned char {
+	arenaTraceAllocate = 1,	// code is the new code, size is the size that was asked for
+	arenaTraceDeallocate,	// code is the code that was deallocated, size is the size of its block
+	arenaTraceRebuild,		// size is the new size of the arena
+	arenaTraceFrame			// a frame ended (MemoryArena::beginFrame was called)
+};
+
+struct ArenaTraceRecord {
+	unsigned long long time; // microseconds since the trace was started
+	DataBlockCodeType code;
+	DataBlockSizeType size;
+	ArenaTraceOp op;
+};
+
+// Records the last recordCount operations of a Memory Arena in a ring buffer (older records are overwritten), so tracing can be left on in a running game.
+// The records can be dumped to a compact binary file that an offline tool can read back and replay against other allocators (see readTrace).
+//
+// File format (little endian, no padding):
+//   "SRAT"              4 byte magic
+//   version             1 byte (1)
+//   width               1 byte, sizeof(DataBlockSizeType) that the codes and sizes were written with
+//   recordCount         8 bytes
+//   recordCount records, oldest first, each: op (1 byte), time (8 bytes), code (width bytes), size (width bytes)
+class MemoryArenaTrace {
+public:
+
+	static constexpr unsigned char formatVersion = 1;
+
+	MemoryArenaTrace(size_t recordCount);
+
+	// Deconstructor, no special purpose.
+	~MemoryArenaTrace();
+
+	void record(ArenaTraceOp op, DataBlockCodeType code, DataBlockSizeType size);
+
+	// the number of records that are held (at most the recordCount the trace was made with).
+	size_t getRecordCount() {
+		return m_count;
+	}
+
+	// writes the records to the file, returns false if the file could not be written.
+	bool dump(const std::string& filename);
+
+	// reads a file written by dump, returns false if it could not be read or was written with a different version or width.
+	static bool readTrace(const std::string& filename, std::vector<ArenaTraceRecord>& records);
+
+private:
+
+	std::vector<ArenaTraceRecord> m_records;
+	size_t m_next = 0; // where the next record is written
+	size_t m_count = 0;
+	std::chrono::steady_clock::time_point m_startTime;
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include "VirtualMemory.h"
+#include "CommonIncludes.h"
+#include <vector>
+#include <utility>
+#include <new>
+
+// A pool of fixed-size records of one type (players, balls and other entities).
+// All slots live in one contiguous range of addresses that is reserved up front, and pages are committed as the pool grows, so a record never moves
+// and iterating over the pool walks memory in order. A released slot stores the index of the next free slot inside itself (an intrusive free list),
+// so acquire and release are O(1) and need no bookkeeping besides one byte per slot that says whether it is in use.
+template <typename T>
+class ObjectPool {
+public:
+
+	ObjectPool(size_t maxCount) {
+		m_maxCount = maxCount;
+		m_reservedSize = VirtualMemory::roundToPages(maxCount * sizeof(Slot));
+		m_slots = (Slot*)VirtualMemory::reserve(m_reservedSize);
+		if (nullptr == m_slots) {
+			throwError("Failed to reserve the address range of an object pool.", logLevelCritical);
+		}
+	}
+
+	// Deconstructor, destroys every record that is still in use and releases the memory.
+	~ObjectPool() {
+		clear();
+		VirtualMemory::release(m_slots, m_reservedSize);
+	}
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	// constructs a record in a free slot with the given arguments.
+	template <typename... Args>
+	T* acquire(Args&&... args) {
+		size_t index;
+		if (noFreeSlot != m_freeSlot) {
+			index = m_freeSlot;
+			m_freeSlot = m_slots[index].nextFreeSlot;
+		} else {
+			if (m_usedSlots == m_committedCount) {
+				growPool();
+			}
+			index = m_usedSlots++;
+		}
+
+		m_inUse[index] = 1;
+		m_liveCount++;
+		return new (&m_slots[index].storage) T(std::forward<Args>(args)...);
+	}
+
+	// destroys the record and puts its slot at the front of the free list, so it is the next one to be reused (while it is still in the cache).
+	void release(T* record) {
+		size_t index = indexOf(record);
+		record->~T();
+
+		m_inUse[index] = 0;
+		m_slots[index].nextFreeSlot = m_freeSlot;
+		m_freeSlot = index;
+		m_liveCount--;
+	}
+
+	// destroys every record that is in use, the committed memory is kept for reuse.
+	void clear() {
+		forEach([](T& record) { record.~T(); });
+		m_freeSlot = noFreeSlot;
+		m_usedSlots = 0;
+		m_liveCount = 0;
+	}
+
+	// calls func on every record that is in use, in the order they are laid out in memory.
+	template <typename Func>
+	void forEach(Func func) {
+		for (size_t index = 0; index < m_usedSlots; index++) {
+			if (m_inUse[index]) {
+				func(*(T*)&m_slots[index].storage);
+			}
+		}
+	}
+
+	size_t indexOf(T* record) {
+		return (Slot*)record - m_slots;
+	}
+
+	size_t getLiveCount() {
+		return m_liveCount;
+	}
+
+	size_t getMaxCount() {
+		return m_maxCount;
+	}
+
+private:
+
+	static constexpr size_t noFreeSlot = ~(size_t)0;
+
+	union Slot {
+		alignas(T) unsigned char storage[sizeof(T)];
+		size_t nextFreeSlot; // only used while the slot is free.
+	};
+
+	Slot* m_slots = nullptr;
+	std::vector<unsigned char> m_inUse; // 1 for every slot that holds a record.
+
+	size_t m_maxCount = 0;
+	size_t m_reservedSize = 0;
+	size_t m_committedCount = 0; // slots that fit in the committed pages
+	size_t m_usedSlots = 0; // slots below this index have been handed out at least once, the rest have never been touched.
+	size_t m_freeSlot = noFreeSlot; // the first slot of the free list
+	size_t m_liveCount = 0;
+
+	// commits twice as many slots (at least a page), up to maxCount.
+	void growPool() {
+		if (m_committedCount >= m_maxCount) {
+			throwError("The object pool is full, create it with a larger maxCount.", logLevelError);
+		}
+
+		size_t committedSize = VirtualMemory::roundToPages(m_committedCount * sizeof(Slot));
+		size_t newCommittedSize = VirtualMemory::roundToPages((m_committedCount ? m_committedCount * 2 : 1) * sizeof(Slot));
+		if (newCommittedSize > m_reservedSize) {
+			newCommittedSize = m_reservedSize;
+		}
+
+		if (!VirtualMemory::commit((char*)m_slots + committedSize, newCommittedSize - committedSize)) {
+			throwError("Failed to commit more memory for an object pool.", logLevelError);
+		}
+
+		m_committedCount = newCommittedSize / sizeof(Slot);
+		if (m_committedCount > m_maxCount) {
+			m_committedCount = m_maxCount;
+		}
+		m_inUse.resize(m_committedCount, 0);
+	}
+};
@@ -0,0 +1,63 @@
+#include "VirtualMemory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+size_t VirtualMemory::pageSize() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+size_t VirtualMemory::roundToPages(size_t size) {
+	size_t page = pageSize();
+	return (size + page - 1) / page * page;
+}
+
+void* VirtualMemory::reserve(size_t size) {
+#ifdef _WIN32
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void* address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return MAP_FAILED == address ? nullptr : address;
+#endif
+}
+
+bool VirtualMemory::commit(void* address, size_t size) {
+	if (0 == size) {
+		return true;
+	}
+#ifdef _WIN32
+	return nullptr != VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+	return 0 == mprotect(address, size, PROT_READ | PROT_WRITE);
+#endif
+}
+
+void VirtualMemory::decommit(void* address, size_t size) {
+	if (0 == size) {
+		return;
+	}
+#ifdef _WIN32
+	VirtualFree(address, size, MEM_DECOMMIT);
+#else
+	madvise(address, size, MADV_DONTNEED);
+	mprotect(address, size, PROT_NONE);
+#endif
+}
+
+void VirtualMemory::release(void* address, size_t size) {
+#ifdef _WIN32
+	VirtualFree(address, 0, MEM_RELEASE);
+#else
+	munmap(address, size);
+#endif
+}
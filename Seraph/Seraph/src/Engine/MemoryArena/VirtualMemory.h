@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Thin wrappers over the virtual memory functions of the OS (VirtualAlloc on windows, mmap elsewhere).
+// A range of addresses is reserved up front without using any memory, and pages inside it are then committed (made usable) or decommitted (given back) as needed.
+namespace VirtualMemory {
+
+	// the size of a page, all committed ranges are rounded to it.
+	size_t pageSize();
+
+	// rounds the size up to a whole number of pages.
+	size_t roundToPages(size_t size);
+
+	// reserves a range of addresses that can not be used until it is committed, returns nullptr if it failed.
+	void* reserve(size_t size);
+
+	// makes the pages in the range usable (readable and writable), returns false if it failed.
+	bool commit(void* address, size_t size);
+
+	// gives the memory of the pages in the range back to the OS, but keeps the range reserved.
+	void decommit(void* address, size_t size);
+
+	// releases the whole range that was returned by reserve.
+	void release(void* address, size_t size);
+}
@@ -1,8 +1,24 @@
 
 #include "MemoryArena.h"
+#include "ConcurrentArena.h"
+#include "FrameArena.h"
+#include "ObjectPool.h"
+#include "Engine/Entity/Entity.h"
 #include <string>
 #include <iostream>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
 #include "_TEST_MemArena.h"
+#include "CommonIncludes.h"
 
 
 int f() {
@@ -38,6 +54,14 @@ int f() {
 				std::cout << std::endl;
 			}
 		}
+		if ("stats" == s) {
+			if (set) {
+				MemoryArenaStats stats = mem.getStats();
+				std::cout << "live " << stats.liveBytes << " bytes, free " << stats.freeBytes << " bytes (largest block " << stats.largestFreeBlock
+					<< ", fragmentation " << stats.fragmentation << "), " << stats.blockCount << " blocks, " << stats.allocCount << " allocs, "
+					<< stats.freeCount << " frees, " << stats.rebuildCount << " rebuilds (" << stats.rebuildMicroseconds << "us)" << std::endl;
+			}
+		}
 		if ("init" == s) { // init the memArena
 			int size;
 			std::cout << "Enter Arena Size\n" << std::endl;
@@ -100,4 +124,558 @@ int f() {
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+// Times resolving block codes through the block table of the Memory Arena against walking a linked list of heap allocated nodes of the same length
+// (the old lookup, when every block had its own DataBlockNode).
+int benchmarkBlockLookup() {
+
+	const int blockCounts[] = { 1000, 10000, 100000 };
+	const int lookupCount = 1000; // the list walk is O(n) per lookup, so only a sample of the codes is looked up.
+
+	void* volatile sink = nullptr;
+
+	for (int blockCount : blockCounts) {
+
+		if ((unsigned long long)blockCount > DataBlockTable::maxBlockCount() || (unsigned long long)blockCount > std::numeric_limits<DataBlockSizeType>::max()) {
+			logRecord("Skipped " + std::to_string(blockCount) + " blocks, as it does not fit in DataBlockCodeType/DataBlockSizeType.", logLevelWarning);
+			continue;
+		}
+
+		MemoryArena arena(blockCount); // every block is 1 byte, so the arena is filled exactly.
+		std::vector<DataBlockCodeType> codes;
+		for (int index = 0; index < blockCount; index++) {
+			codes.push_back(arena.allocateData(1));
+		}
+
+		struct ListNode {
+			DataBlockCodeType code;
+			ListNode* next;
+		};
+		ListNode* head = nullptr;
+		for (int index = blockCount; index > 0; index--) {
+			head = new ListNode{ (DataBlockCodeType)index, head };
+		}
+
+		std::string tableName = "block table, " + std::to_string(blockCount) + " blocks, " + std::to_string(lookupCount) + " lookups";
+		std::string listName = "list walk, " + std::to_string(blockCount) + " blocks, " + std::to_string(lookupCount) + " lookups";
+
+		{
+			Timer(tableTimer, tableName.c_str());
+			for (int index = 0; index < lookupCount; index++) {
+				sink = arena.getDataAddress(codes[(long long)index * blockCount / lookupCount]);
+			}
+		}
+		{
+			Timer(listTimer, listName.c_str());
+			for (int index = 0; index < lookupCount; index++) {
+				DataBlockCodeType code = (DataBlockCodeType)((long long)index * blockCount / lookupCount + 1);
+				ListNode* current = head;
+				while (nullptr != current && current->code != code) {
+					current = current->next;
+				}
+				sink = current;
+			}
+		}
+
+		while (nullptr != head) {
+			ListNode* next = head->next;
+			delete head;
+			head = next;
+		}
+	}
+
+	// the lookups only write to the sink, reading it here keeps them from being dropped. The last list walk always finds its node.
+	if (nullptr == sink) {
+		logRecord("The last list walk did not find its block.", logLevelWarning);
+	}
+
+	logRecord("Every block costs " + std::to_string(DataBlockTable::bytesPerBlock()) + " bytes of metadata (a " + std::to_string(sizeof(DataBlock))
+		+ " byte dataBlock and its state), and no heap allocation of its own.", logLevelInfo);
+
+	return 0;
+}
+
+// Checks that growing the arena never wraps around DataBlockSizeType, both by doubling the size until it cannot grow any further,
+// and (for 64 bit arenas) by growing past 4 gb. It also grows a small arena through many rebuilds and checks that the data survives.
+int testArenaGrowth() {
+
+	int failures = 0;
+
+	DataBlockSizeType size = 1;
+	while (size != std::numeric_limits<DataBlockSizeType>::max()) {
+		DataBlockSizeType newSize = MemoryArena::resizedArenaSize(size, 2);
+		if (newSize <= size) {
+			logRecord("Arena size wrapped from " + std::to_string(size) + " to " + std::to_string(newSize), logLevelError);
+			failures++;
+			break;
+		}
+		size = newSize;
+	}
+
+	if (sizeof(DataBlockSizeType) >= 8) {
+		unsigned long long threeGb = 3ull << 30;
+		unsigned long long grown = MemoryArena::resizedArenaSize((DataBlockSizeType)threeGb, 2);
+		if (grown != 2 * threeGb) {
+			logRecord("Growing a 3 gb arena gave " + std::to_string(grown) + " bytes instead of 6 gb.", logLevelError);
+			failures++;
+		}
+	}
+
+	MemoryArena arena(1);
+	std::vector<DataBlockCodeType> codes;
+	for (int index = 0; index < 1000; index++) {
+		codes.push_back(arena.allocateData(sizeof(int)));
+		*(int*)arena.getDataAddress(codes.back()) = index;
+	}
+	for (int index = 0; index < 1000; index++) {
+		if (*(int*)arena.getDataAddress(codes[index]) != index) {
+			logRecord("Data of block " + std::to_string(index) + " was lost while the arena grew.", logLevelError);
+			failures++;
+			break;
+		}
+	}
+
+	// arenaGrowthReserve: addresses must stay the same while the arena grows, and the arena must shrink again once the data is deallocated.
+	MemoryArena reservedArena(1, (DataBlockSizeType)~(DataBlockSizeType)0 > (1 << 24) ? (DataBlockSizeType)(1 << 24) : (DataBlockSizeType)~(DataBlockSizeType)0);
+	DataBlockCodeType firstCode = reservedArena.allocateData(sizeof(int));
+	void* firstAddress = reservedArena.getDataAddress(firstCode);
+	std::vector<DataBlockCodeType> reservedCodes;
+	for (int index = 0; index < 1000; index++) {
+		reservedCodes.push_back(reservedArena.allocateData(32));
+	}
+	if (reservedArena.getDataAddress(firstCode) != firstAddress) {
+		logRecord("A reserved arena moved its data while it grew.", logLevelError);
+		failures++;
+	}
+	DataBlockSizeType grownSize = reservedArena.getSize();
+	for (DataBlockCodeType code : reservedCodes) {
+		reservedArena.deallocateData(code);
+	}
+	if (reservedArena.getSize() >= grownSize / 2) {
+		logRecord("A reserved arena did not shrink after its data was deallocated (" + std::to_string(reservedArena.getSize()) + " bytes left).", logLevelError);
+		failures++;
+	}
+
+	// A 64 bit arena must be able to grow past 4 gb of reserved addresses without wrapping. The blocks are never written to, so little memory is actually used.
+	if (sizeof(DataBlockSizeType) >= 8) {
+		const unsigned long long oneGb = 1ull << 30;
+		MemoryArena hugeArena(1, (DataBlockSizeType)(8 * oneGb));
+		DataBlockCodeType hugeFirstCode = hugeArena.allocateData(sizeof(int));
+		void* hugeFirstAddress = hugeArena.getDataAddress(hugeFirstCode);
+		for (int index = 0; index < 5; index++) {
+			hugeArena.allocateData((DataBlockSizeType)oneGb);
+		}
+		if ((unsigned long long)hugeArena.getSize() <= 4 * oneGb || hugeArena.getDataAddress(hugeFirstCode) != hugeFirstAddress) {
+			logRecord("A reserved arena failed to grow past 4 gb (it is " + std::to_string(hugeArena.getSize()) + " bytes).", logLevelError);
+			failures++;
+		}
+	}
+	// A 32 bit arena tops out just below 4 gb, so the allocation that would take it past that has to be refused, not wrap the size around to something small.
+	else if (sizeof(DataBlockSizeType) == 4) {
+		const DataBlockSizeType oneGb = (DataBlockSizeType)(1ull << 30);
+		MemoryArena fullArena(1, std::numeric_limits<DataBlockSizeType>::max());
+		DataBlockSizeType lastSize = fullArena.getSize();
+		bool refused = false;
+		bool shrank = false;
+		for (int index = 0; index < 5 && !refused; index++) {
+			try {
+				fullArena.allocateData(oneGb);
+			}
+			catch (const std::runtime_error&) {
+				refused = true;
+			}
+			shrank |= fullArena.getSize() < lastSize;
+			lastSize = fullArena.getSize();
+		}
+		if (!refused || shrank) {
+			logRecord("A 32 bit arena did not refuse to grow past 4 gb (it is " + std::to_string(fullArena.getSize()) + " bytes).", logLevelError);
+			failures++;
+		}
+	}
+
+	logRecord("Arena growth test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// Runs the same random allocate/write/check/deallocate workload on a number of threads, and returns the operations per second.
+// Every block is stamped with its owner and a counter, and the stamp is checked before it is deallocated, so blocks that are handed out twice are counted as failures.
+template <typename AllocateFunc, typename DeallocateFunc, typename AddressFunc>
+static double runArenaWorkload(int threadCount, int operationCount, AllocateFunc allocate, DeallocateFunc deallocate, AddressFunc address, std::atomic<int>& failures) {
+	const int liveCount = 128; // blocks that each thread keeps alive at most
+
+	auto worker = [&](int threadIndex) {
+		std::vector<std::pair<DataBlockCodeType, unsigned long long>> live;
+		unsigned long long random = 0x9E3779B97F4A7C15ull * (threadIndex + 1);
+
+		for (int operation = 0; operation < operationCount; operation++) {
+			random = random * 6364136223846793005ull + 1442695040888963407ull;
+
+			if (live.empty() || ((random >> 33) & 1 && (int)live.size() < liveCount)) {
+				DataBlockSizeType size = (DataBlockSizeType)(8 + (random >> 40) % 249);
+				unsigned long long stamp = ((unsigned long long)threadIndex << 32) | (unsigned int)operation;
+				DataBlockCodeType code = allocate(size);
+				memcpy(address(code), &stamp, sizeof(stamp)); // the plain arena does not align its blocks.
+				live.push_back({ code, stamp });
+			} else {
+				size_t index = (random >> 40) % live.size();
+				unsigned long long stamp;
+				memcpy(&stamp, address(live[index].first), sizeof(stamp));
+				if (stamp != live[index].second) {
+					failures++;
+				}
+				deallocate(live[index].first);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+		for (std::pair<DataBlockCodeType, unsigned long long>& block : live) {
+			deallocate(block.first);
+		}
+	};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for (int index = 0; index < threadCount; index++) {
+		threads.emplace_back(worker, index);
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return (double)threadCount * operationCount / seconds;
+}
+
+// Stress tests the ConcurrentArena from 1 up to every core, and compares its throughput against a single MemoryArena behind a mutex.
+int benchmarkConcurrentArena() {
+
+	if (sizeof(DataBlockSizeType) < 4) {
+		logRecord("Skipped the concurrent arena benchmark, as a 16 bit arena is too small for it.", logLevelWarning);
+		return 0;
+	}
+
+	const int operationCount = 200000; // per thread
+	const DataBlockSizeType reservedSize = (DataBlockSizeType)std::min<unsigned long long>(1ull << 30, std::numeric_limits<DataBlockSizeType>::max());
+	int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	std::atomic<int> failures = 0;
+
+	for (int threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreads)) {
+
+		ConcurrentArena concurrentArena(1 << 16, reservedSize);
+		double concurrentRate = runArenaWorkload(threadCount, operationCount,
+			[&](DataBlockSizeType size) { return concurrentArena.allocateData(size); },
+			[&](DataBlockCodeType code) { concurrentArena.deallocateData(code); },
+			[&](DataBlockCodeType code) { return concurrentArena.getDataAddress(code); },
+			failures);
+
+		MemoryArena lockedArena(1 << 16, reservedSize);
+		std::mutex lockedArenaMutex;
+		double lockedRate = runArenaWorkload(threadCount, operationCount,
+			[&](DataBlockSizeType size) { std::lock_guard<std::mutex> lock(lockedArenaMutex); return lockedArena.allocateData(size); },
+			[&](DataBlockCodeType code) { std::lock_guard<std::mutex> lock(lockedArenaMutex); lockedArena.deallocateData(code); },
+			[&](DataBlockCodeType code) { std::lock_guard<std::mutex> lock(lockedArenaMutex); return lockedArena.getDataAddress(code); },
+			failures);
+
+		logRecord(std::to_string(threadCount) + " threads: concurrent arena " + std::to_string((long long)(concurrentRate / 1000)) + "k ops/s, locked arena "
+			+ std::to_string((long long)(lockedRate / 1000)) + "k ops/s.", logLevelInfo);
+
+		if (threadCount == maxThreads) {
+			break;
+		}
+	}
+
+	logRecord("Concurrent arena benchmark finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// counts every allocation that it passes on to the heap, so a test can check that a piece of code stopped allocating.
+static unsigned long long countedHeapAllocations = 0;
+
+template <typename T>
+struct CountingAllocator {
+	using value_type = T;
+
+	CountingAllocator() {}
+
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>&) {}
+
+	T* allocate(size_t count) {
+		countedHeapAllocations++;
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* pointer, size_t count) {
+		std::allocator<T>().deallocate(pointer, count);
+	}
+
+	template <typename U>
+	bool operator==(const CountingAllocator<U>&) const {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const CountingAllocator<U>&) const {
+		return false;
+	}
+};
+
+// Runs frames shaped like the clipping in runEngine (scratch vectors built in frame memory, then copied into long lived vectors),
+// and checks that once the first frames have sized everything, a frame makes no heap allocations at all.
+int testFrameArena() {
+
+	int failures = 0;
+
+	FrameArena frameArena(64, 2); // far too small on purpose, so the first frames overflow and the buffers have to grow.
+	std::vector<float, CountingAllocator<float>> persistentData;
+	std::vector<unsigned short, CountingAllocator<unsigned short>> persistentIndices;
+
+	const int warmupFrames = 10; // long enough to see the biggest frame (frame % 7 == 6) in both buffers.
+	unsigned long long overflowsAfterWarmup = 0;
+	unsigned long long allocationsAfterWarmup = 0;
+
+	for (int frame = 0; frame < 100; frame++) {
+		frameArena.beginFrame();
+
+		if (warmupFrames == frame) {
+			overflowsAfterWarmup = frameArena.getOverflowCount();
+			allocationsAfterWarmup = countedHeapAllocations;
+		}
+
+		int itemCount = 1000 + (frame % 7) * 100; // the amount of data changes a little from frame to frame
+		for (int pass = 0; pass < 4; pass++) {
+			FrameVector<float> scratchData{ FrameAllocator<float>(frameArena) };
+			FrameVector<unsigned short> scratchIndices{ FrameAllocator<unsigned short>(frameArena) };
+			for (int index = 0; index < itemCount; index++) {
+				scratchData.push_back((float)index);
+				scratchIndices.push_back((unsigned short)index);
+			}
+
+			if ((size_t)scratchData.data() % alignof(float) != 0) {
+				failures++;
+			}
+
+			persistentData.assign(scratchData.begin(), scratchData.end());
+			persistentIndices.assign(scratchIndices.begin(), scratchIndices.end());
+		}
+	}
+
+	if (frameArena.getOverflowCount() != overflowsAfterWarmup) {
+		logRecord("The frame arena still overflowed to the heap after " + std::to_string(warmupFrames) + " frames.", logLevelError);
+		failures++;
+	}
+	if (countedHeapAllocations != allocationsAfterWarmup) {
+		logRecord(std::to_string(countedHeapAllocations - allocationsAfterWarmup) + " heap allocations were made in steady state frames.", logLevelError);
+		failures++;
+	}
+
+	logRecord("Frame arena test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// Spawns and despawns a million balls, once from an ObjectPool and once from byte blocks of a MemoryArena (the way runEngine used to place entities),
+// and times spawning, moving every ball, and despawning for both.
+int benchmarkObjectPool() {
+
+	const int ballCount = 1000000;
+
+	if (ballCount > DataBlockTable::maxBlockCount() || (unsigned long long)ballCount * sizeof(Ball) > std::numeric_limits<DataBlockSizeType>::max()) {
+		logRecord("Skipped the object pool benchmark, as a million balls do not fit in DataBlockCodeType/DataBlockSizeType.", logLevelWarning);
+		return 0;
+	}
+
+	int failures = 0;
+	long long positionSum = 0;
+
+	{
+		ObjectPool<Ball> pool(ballCount);
+		std::vector<Ball*> balls;
+		balls.reserve(ballCount);
+
+		{
+			Timer(poolSpawn, "object pool, spawn 1M balls");
+			for (int index = 0; index < ballCount; index++) {
+				Location ballPos((short)index, 0);
+				balls.push_back(pool.acquire((char)1, ballPos));
+			}
+		}
+		{
+			Timer(poolMove, "object pool, move 1M balls");
+			pool.forEach([&](Ball& ball) { ball.pos.s_y++; positionSum += ball.pos.s_y; });
+		}
+		{
+			Timer(poolDespawn, "object pool, despawn 1M balls");
+			for (Ball* ball : balls) {
+				pool.release(ball);
+			}
+		}
+
+		if (pool.getLiveCount() != 0) {
+			failures++;
+		}
+	}
+
+	{
+		MemoryArena arena(1);
+		std::vector<DataBlockCodeType> codes;
+		codes.reserve(ballCount);
+
+		{
+			Timer(arenaSpawn, "memory arena, spawn 1M balls");
+			for (int index = 0; index < ballCount; index++) {
+				Location ballPos((short)index, 0);
+				codes.push_back(arena.allocateData(sizeof(Ball)));
+				*(Ball*)arena.getDataAddress(codes.back()) = Ball((char)1, ballPos);
+			}
+		}
+		{
+			Timer(arenaMove, "memory arena, move 1M balls");
+			for (DataBlockCodeType code : codes) {
+				Ball* ball = (Ball*)arena.getDataAddress(code);
+				ball->pos.s_y++;
+				positionSum -= ball->pos.s_y;
+			}
+		}
+		{
+			Timer(arenaDespawn, "memory arena, despawn 1M balls");
+			for (DataBlockCodeType code : codes) {
+				arena.deallocateData(code);
+			}
+		}
+	}
+
+	if (0 != positionSum) {
+		failures++; // both runs moved the same balls, so their sums cancel out.
+	}
+
+	logRecord("Object pool benchmark finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// Fragments an arena by deallocating every other block, then compacts it a little at a time (like a frame would) and checks that the data of every block
+// survived the move, that the unused space ends up in one block, and that a fragmented arena packs its blocks rather than growing when it runs out of room.
+int testArenaCompaction() {
+
+	int failures = 0;
+	const int blockCount = 1000;
+
+	for (int growthMode = 0; growthMode < 2; growthMode++) {
+
+		MemoryArena arena = arenaGrowthCopy == growthMode ? MemoryArena(blockCount * sizeof(int)) : MemoryArena(blockCount * sizeof(int), blockCount * sizeof(int) * 4);
+		std::vector<DataBlockCodeType> codes;
+		for (int index = 0; index < blockCount; index++) {
+			codes.push_back(arena.allocateData(sizeof(int)));
+			*(int*)arena.getDataAddress(codes.back()) = index;
+		}
+		for (int index = 0; index < blockCount; index += 2) {
+			arena.deallocateData(codes[index]);
+		}
+
+		if (arena.getFragmentation() < 0.9f) {
+			logRecord("An arena with every other block unused reported a fragmentation of only " + std::to_string(arena.getFragmentation()), logLevelError);
+			failures++;
+		}
+
+		int calls = 1;
+		while (!arena.compactArena(10)) {
+			calls++;
+		}
+
+		for (int index = 1; index < blockCount; index += 2) {
+			if (*(int*)arena.getDataAddress(codes[index]) != index) {
+				logRecord("Data of block " + std::to_string(index) + " was lost while the arena was compacted.", logLevelError);
+				failures++;
+				break;
+			}
+		}
+		if (arena.getFragmentation() != 0) {
+			logRecord("A compacted arena still has a fragmentation of " + std::to_string(arena.getFragmentation()), logLevelError);
+			failures++;
+		}
+
+		logRecord("Compacted " + std::to_string(blockCount / 2) + " blocks in " + std::to_string(calls) + " calls of 10us.", logLevelInfo);
+	}
+
+	// a full but fragmented copy arena packs its blocks instead of growing.
+	MemoryArena arena(blockCount * sizeof(int));
+	std::vector<DataBlockCodeType> codes;
+	for (int index = 0; index < blockCount; index++) {
+		codes.push_back(arena.allocateData(sizeof(int)));
+		*(int*)arena.getDataAddress(codes.back()) = index;
+	}
+	for (int index = 0; index < blockCount; index += 2) {
+		arena.deallocateData(codes[index]);
+	}
+	DataBlockSizeType sizeBefore = arena.getSize();
+	DataBlockCodeType bigCode = arena.allocateData(blockCount / 2 * sizeof(int));
+	if (arena.getSize() != sizeBefore || nullptr == arena.getDataAddress(bigCode) || *(int*)arena.getDataAddress(codes[blockCount - 1]) != blockCount - 1) {
+		logRecord("A fragmented arena grew (or lost data) instead of packing its blocks.", logLevelError);
+		failures++;
+	}
+
+	logRecord("Arena compaction test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
+
+// Checks the counters of getStats against a known workload, then dumps the allocation trace, reads it back and replays it into a fresh arena,
+// which has to end up with the same live bytes and blocks as the traced arena.
+int testArenaStatsAndTrace() {
+
+	int failures = 0;
+	const std::string traceFile = "memory_arena_trace_test.bin";
+
+	MemoryArena arena(16);
+	arena.enableTrace(10000);
+
+	std::vector<DataBlockCodeType> codes;
+	for (int frame = 0; frame < 10; frame++) {
+		arena.beginFrame();
+		for (int index = 0; index < 20; index++) {
+			codes.push_back(arena.allocateData((DataBlockSizeType)(1 + (frame * 20 + index) % 13)));
+		}
+		for (int index = 0; index < 5; index++) {
+			arena.deallocateData(codes[frame * 20 + index * 3]);
+		}
+	}
+
+	MemoryArenaStats stats = arena.getStats();
+	arena.beginFrame();
+	MemoryArenaStats frameStats = arena.getStats();
+
+	if (200 != stats.allocCount || 50 != stats.freeCount || 150 != stats.blockCount || 20 != frameStats.allocsLastFrame || 5 != frameStats.freesLastFrame) {
+		logRecord("The arena counted " + std::to_string(stats.allocCount) + " allocs, " + std::to_string(stats.freeCount) + " frees and "
+			+ std::to_string(stats.blockCount) + " blocks instead of 200, 50 and 150.", logLevelError);
+		failures++;
+	}
+	if (stats.liveBytes + stats.freeBytes != stats.arenaSize || stats.largestFreeBlock > stats.freeBytes || 0 == stats.rebuildCount) {
+		logRecord("The byte counters of the arena do not add up.", logLevelError);
+		failures++;
+	}
+
+	std::vector<ArenaTraceRecord> records;
+	if (!arena.dumpTrace(traceFile) || !MemoryArenaTrace::readTrace(traceFile, records)) {
+		logRecord("Failed to write and read back the arena trace.", logLevelError);
+		failures++;
+	}
+	std::remove(traceFile.c_str());
+
+	MemoryArena replayArena(16);
+	std::map<DataBlockCodeType, DataBlockCodeType> replayCodes; // traced code -> code in the replay arena
+	for (ArenaTraceRecord& someRecord : records) {
+		if (arenaTraceAllocate == someRecord.op) {
+			replayCodes[someRecord.code] = replayArena.allocateData(someRecord.size);
+		} else if (arenaTraceDeallocate == someRecord.op && replayCodes.count(someRecord.code)) {
+			replayArena.deallocateData(replayCodes[someRecord.code]);
+			replayCodes.erase(someRecord.code);
+		}
+	}
+	if (replayArena.getUsedSize() != stats.liveBytes || replayArena.getStats().blockCount != stats.blockCount) {
+		logRecord("Replaying the trace gave " + std::to_string(replayArena.getUsedSize()) + " live bytes instead of " + std::to_string(stats.liveBytes), logLevelError);
+		failures++;
+	}
+
+	logRecord("Arena stats and trace test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+	return failures;
+}
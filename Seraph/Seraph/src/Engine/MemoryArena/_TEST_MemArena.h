@@ -1,3 +1,17 @@
 #pragma once
 
-int f();
\ No newline at end of file
+int f();
+
+int benchmarkBlockLookup();
+
+int testArenaGrowth();
+
+int benchmarkConcurrentArena();
+
+int testFrameArena();
+
+int benchmarkObjectPool();
+
+int testArenaCompaction();
+
+int testArenaStatsAndTrace();
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "GpuMemoryAllocator.h"
+#include "CommonIncludes.h"
+
+void GpuMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) {
+    m_device = device;
+    m_blockSize = blockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    m_pools.clear();
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+}
+
+void GpuMemoryAllocator::destroy() {
+    for (Pool& pool : m_pools) {
+        for (Block& block : pool.blocks) {
+            freeBlock(block);
+        }
+        pool.blocks.clear();
+    }
+}
+
+bool GpuMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& memoryType) {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            memoryType = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GpuMemoryAllocator::allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset) {
+    for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); range++) {
+        VkDeviceSize rangeStart = range->first;
+        VkDeviceSize rangeEnd = range->first + range->second;
+        VkDeviceSize start = (rangeStart + requirements.alignment - 1) / requirements.alignment * requirements.alignment; // the alignment is a power of 2, but dividing does not rely on it.
+        if (start + requirements.size > rangeEnd) {
+            continue;
+        }
+
+        // the range is split into the padding in front (which stays free) and what is left after the allocation.
+        block.freeRanges.erase(range);
+        if (start > rangeStart) {
+            block.freeRanges[rangeStart] = start - rangeStart;
+        }
+        if (rangeEnd > start + requirements.size) {
+            block.freeRanges[start + requirements.size] = rangeEnd - (start + requirements.size);
+        }
+
+        offset = start;
+        block.allocationCount++;
+        block.usedBytes += requirements.size;
+        return true;
+    }
+    return false;
+}
+
+bool GpuMemoryAllocator::createBlock(Pool& pool, uint32_t memoryType, VkDeviceSize size, uint32_t& blockIndex) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        return false;
+    }
+    m_deviceAllocationCalls++;
+
+    void* mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            vkFreeMemory(m_device, memory, nullptr);
+            return false;
+        }
+    }
+
+    // a slot of a freed block is reused, so the block index of every other allocation stays the same.
+    blockIndex = (uint32_t)pool.blocks.size();
+    for (uint32_t index = 0; index < pool.blocks.size(); index++) {
+        if (VK_NULL_HANDLE == pool.blocks[index].memory) {
+            blockIndex = index;
+            break;
+        }
+    }
+    if (blockIndex == pool.blocks.size()) {
+        pool.blocks.emplace_back();
+    }
+
+    Block& block = pool.blocks[blockIndex];
+    block.memory = memory;
+    block.size = size;
+    block.mapped = (char*)mapped;
+    block.freeRanges.clear();
+    block.freeRanges[0] = size;
+    block.allocationCount = 0;
+    block.usedBytes = 0;
+    return true;
+}
+
+void GpuMemoryAllocator::freeBlock(Block& block) {
+    if (VK_NULL_HANDLE == block.memory) {
+        return;
+    }
+    // freeing mapped memory unmaps it.
+    vkFreeMemory(m_device, block.memory, nullptr);
+    block.memory = VK_NULL_HANDLE;
+    block.mapped = nullptr;
+    block.size = 0;
+    block.freeRanges.clear();
+}
+
+bool GpuMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, GpuAllocation& allocation) {
+    uint32_t memoryType;
+    if (!findMemoryType(requirements.memoryTypeBits, properties, memoryType)) {
+        return false;
+    }
+
+    uint32_t poolIndex = poolIndexOf(memoryType, linear);
+    Pool& pool = m_pools[poolIndex];
+
+    uint32_t blockIndex = 0;
+    VkDeviceSize offset = 0;
+    bool found = false;
+
+    if (requirements.size <= m_blockSize / 2) {
+        for (blockIndex = 0; blockIndex < pool.blocks.size(); blockIndex++) {
+            if (VK_NULL_HANDLE != pool.blocks[blockIndex].memory && allocateFromBlock(pool.blocks[blockIndex], requirements, offset)) {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        // small heaps (such as the 256mb of device local memory that is host visible without resizable bar) get smaller blocks.
+        VkDeviceSize blockSize = m_blockSize;
+        VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+        if (blockSize > heapSize / 8) {
+            blockSize = heapSize / 8;
+        }
+        if (requirements.size > blockSize / 2) {
+            blockSize = requirements.size; // a dedicated block.
+        }
+
+        if (!createBlock(pool, memoryType, blockSize, blockIndex)) {
+            if (blockSize == requirements.size || !createBlock(pool, memoryType, requirements.size, blockIndex)) {
+                return false;
+            }
+        }
+        allocateFromBlock(pool.blocks[blockIndex], requirements, offset);
+    }
+
+    Block& block = pool.blocks[blockIndex];
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mapped = nullptr == block.mapped ? nullptr : block.mapped + offset;
+    allocation.poolIndex = poolIndex;
+    allocation.blockIndex = blockIndex;
+    return true;
+}
+
+void GpuMemoryAllocator::free(GpuAllocation& allocation) {
+    if (VK_NULL_HANDLE == allocation.memory) {
+        return;
+    }
+
+    Pool& pool = m_pools[allocation.poolIndex];
+    Block& block = pool.blocks[allocation.blockIndex];
+
+    VkDeviceSize start = allocation.offset;
+    VkDeviceSize size = allocation.size;
+
+    // merges with the free range after it, then with the one before it.
+    auto next = block.freeRanges.lower_bound(start);
+    if (next != block.freeRanges.end() && next->first == start + size) {
+        size += next->second;
+        next = block.freeRanges.erase(next);
+    }
+    if (next != block.freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == start) {
+            start = previous->first;
+            size += previous->second;
+            block.freeRanges.erase(previous);
+        }
+    }
+    block.freeRanges[start] = size;
+
+    block.allocationCount--;
+    block.usedBytes -= allocation.size;
+    allocation = GpuAllocation();
+
+    if (0 == block.allocationCount) {
+        int liveBlocks = 0;
+        for (Block& someBlock : pool.blocks) {
+            if (VK_NULL_HANDLE != someBlock.memory) {
+                liveBlocks++;
+            }
+        }
+        // the last block is kept, so a pool that is emptied and refilled every frame does not call vkAllocateMemory every frame.
+        if (liveBlocks > 1) {
+            freeBlock(block);
+        }
+    }
+}
+
+void GpuMemoryAllocator::addStats(Pool& pool, GpuMemoryStats& stats) {
+    for (Block& block : pool.blocks) {
+        if (VK_NULL_HANDLE == block.memory) {
+            continue;
+        }
+        stats.blockCount++;
+        stats.allocationCount += block.allocationCount;
+        stats.reservedBytes += block.size;
+        stats.usedBytes += block.usedBytes;
+    }
+}
+
+GpuMemoryStats GpuMemoryAllocator::getStats() {
+    GpuMemoryStats stats;
+    for (Pool& pool : m_pools) {
+        addStats(pool, stats);
+    }
+    stats.deviceAllocationCalls = m_deviceAllocationCalls;
+    return stats;
+}
+
+GpuMemoryStats GpuMemoryAllocator::getStats(uint32_t memoryTypeIndex) {
+    GpuMemoryStats stats;
+    if (memoryTypeIndex < m_memoryProperties.memoryTypeCount) {
+        addStats(m_pools[poolIndexOf(memoryTypeIndex, false)], stats);
+        addStats(m_pools[poolIndexOf(memoryTypeIndex, true)], stats);
+    }
+    stats.deviceAllocationCalls = m_deviceAllocationCalls;
+    return stats;
+}
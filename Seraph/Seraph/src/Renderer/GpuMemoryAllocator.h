@@ -0,0 +1,89 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// The part of a memory block that a buffer or image is bound to.
+struct GpuAllocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; // where the allocation starts in host memory, only set for host visible memory (which is kept mapped).
+	uint32_t poolIndex = 0;
+	uint32_t blockIndex = 0;
+};
+
+struct GpuMemoryStats {
+	uint32_t blockCount = 0; // the number of vkAllocateMemory allocations that are alive.
+	uint32_t allocationCount = 0; // the number of buffers and images placed in the blocks.
+	VkDeviceSize reservedBytes = 0; // the size of all blocks.
+	VkDeviceSize usedBytes = 0; // the size of all allocations (without the padding that aligning them leaves).
+	unsigned long long deviceAllocationCalls = 0; // vkAllocateMemory calls since init, to compare against the one call per buffer/image this replaces.
+};
+
+// Hands out memory for buffers and images from a few large VkDeviceMemory blocks instead of a vkAllocateMemory per resource,
+// which is slow and limited by maxMemoryAllocationCount (as low as 4096 on some drivers).
+// There is a pool per memory type, and buffers are kept apart from optimal tiling images (linear = false) so they never share a block and
+// bufferImageGranularity does not have to be padded for. Each block keeps its free ranges sorted by offset, allocating takes the first range
+// that fits once aligned, and freeing merges the range back with its neighbours. Host visible blocks are mapped once when they are made.
+class GpuMemoryAllocator {
+public:
+
+	static constexpr VkDeviceSize defaultBlockSize = 64ull << 20;
+
+	GpuMemoryAllocator() {}
+
+	// Deconstructor, no special purpose. destroy has to be called before the device is destroyed.
+	~GpuMemoryAllocator() {}
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = defaultBlockSize);
+
+	// frees every block, any allocation still alive is lost.
+	void destroy();
+
+	// finds memory of a type allowed by the requirements with the properties. Allocations bigger than half a block get a block of their own.
+	// Returns false when no memory type fits or the device is out of memory.
+	bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, GpuAllocation& allocation);
+
+	// gives the memory back, a block that becomes empty is freed unless it is the last block of its pool.
+	void free(GpuAllocation& allocation);
+
+	GpuMemoryStats getStats();
+
+	// the stats of one memory type.
+	GpuMemoryStats getStats(uint32_t memoryTypeIndex);
+
+private:
+
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE; // VK_NULL_HANDLE for a slot whose block was freed.
+		VkDeviceSize size = 0;
+		char* mapped = nullptr;
+		std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size
+		uint32_t allocationCount = 0;
+		VkDeviceSize usedBytes = 0;
+	};
+
+	struct Pool {
+		std::vector<Block> blocks;
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+	VkDeviceSize m_blockSize = defaultBlockSize;
+	std::vector<Pool> m_pools; // two per memory type, see poolIndexOf.
+	unsigned long long m_deviceAllocationCalls = 0;
+
+	static uint32_t poolIndexOf(uint32_t memoryType, bool linear) {
+		return memoryType * 2 + (linear ? 1 : 0);
+	}
+
+	bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& memoryType);
+	bool allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset);
+	bool createBlock(Pool& pool, uint32_t memoryType, VkDeviceSize size, uint32_t& blockIndex);
+	void freeBlock(Block& block);
+	void addStats(Pool& pool, GpuMemoryStats& stats);
+};
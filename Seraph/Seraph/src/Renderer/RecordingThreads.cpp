@@ -0,0 +1,87 @@
+#include "RecordingThreads.h"
+
+RecordingThreads::~RecordingThreads() {
+    stop();
+}
+
+void RecordingThreads::start(uint32_t threadCount) {
+    stop();
+    m_stopping = false;
+    for (uint32_t threadIndex = 1; threadIndex < threadCount; threadIndex++) {
+        m_threads.emplace_back(&RecordingThreads::threadLoop, this, threadIndex, m_jobGeneration); // a job given before the thread gets going is still seen as new.
+    }
+}
+
+void RecordingThreads::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void RecordingThreads::run(const std::function<void(uint32_t threadIndex)>& job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_jobGeneration++;
+        m_threadsBusy = (uint32_t)m_threads.size();
+        m_jobException = nullptr;
+    }
+    m_jobReady.notify_all();
+
+    std::exception_ptr callerException;
+    try {
+        job(0);
+    }
+    catch (...) {
+        callerException = std::current_exception();
+    }
+
+    // the other threads still use the job, so they are waited for even if this thread's part failed.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this]() { return 0 == m_threadsBusy; });
+    m_job = nullptr;
+
+    if (callerException) {
+        std::rethrow_exception(callerException);
+    }
+    if (m_jobException) {
+        std::rethrow_exception(m_jobException);
+    }
+}
+
+void RecordingThreads::threadLoop(uint32_t threadIndex, unsigned long long lastGeneration) {
+    while (true) {
+        const std::function<void(uint32_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobReady.wait(lock, [&]() { return m_stopping || m_jobGeneration != lastGeneration; });
+            if (m_stopping) {
+                return;
+            }
+            lastGeneration = m_jobGeneration;
+            job = m_job;
+        }
+
+        std::exception_ptr exception;
+        try {
+            (*job)(threadIndex);
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (exception && !m_jobException) {
+            m_jobException = exception;
+        }
+        if (0 == --m_threadsBusy) {
+            m_jobDone.notify_one();
+        }
+    }
+}
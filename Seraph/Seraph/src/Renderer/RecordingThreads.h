@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+// Threads that are kept alive between frames to record command buffers, starting a thread every frame would cost more than recording a small frame.
+// run hands every thread the same job together with the index of the thread, the calling thread takes index 0 so a single thread never waits on anything.
+class RecordingThreads {
+public:
+
+	RecordingThreads() {}
+
+	// Deconstructor, stops the threads if stop has not been called.
+	~RecordingThreads();
+
+	RecordingThreads(const RecordingThreads&) = delete;
+	RecordingThreads& operator=(const RecordingThreads&) = delete;
+
+	// starts threadCount - 1 threads, the caller of run is the last one.
+	void start(uint32_t threadCount);
+
+	// waits for the threads to finish and joins them.
+	void stop();
+
+	// runs the job on every thread and returns once all of them are done. An exception thrown by the job on any thread is thrown again here.
+	void run(const std::function<void(uint32_t threadIndex)>& job);
+
+	uint32_t threadCount() {
+		return (uint32_t)m_threads.size() + 1;
+	}
+
+private:
+
+	void threadLoop(uint32_t threadIndex, unsigned long long lastGeneration);
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_jobDone;
+
+	const std::function<void(uint32_t)>* m_job = nullptr;
+	unsigned long long m_jobGeneration = 0; // counts up with every job, so a thread knows a job is new.
+	uint32_t m_threadsBusy = 0;
+	bool m_stopping = false;
+	std::exception_ptr m_jobException;
+};
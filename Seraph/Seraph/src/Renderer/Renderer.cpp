@@ -1,4 +1,5 @@
 #include "Renderer.h"
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "Depedencies/stb_image.h"
@@ -51,8 +52,7 @@ void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& create
 void cleanupSwapChain(Renderer::Context& renderer) {
 
     vkDestroyImageView(renderer.vk_device, renderer.vk_depthImageView, nullptr);
-    vkDestroyImage(renderer.vk_device, renderer.vk_depthImage, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_depthImageMemory, nullptr);
+    destroyImage(renderer, renderer.vk_depthImage, renderer.vk_depthImageAllocation);
 
     for (size_t i = 0; i < renderer.vk_swapChainFramebuffers.size(); i++) {
         vkDestroyFramebuffer(renderer.vk_device, renderer.vk_swapChainFramebuffers[i], nullptr);
@@ -114,6 +114,14 @@ void recreateSwapChain(Renderer::Context& renderer) {
     createImageViews(renderer);
     createDepthResources(renderer);
     createFramebuffers(renderer);
+
+    // the cached command buffers use the old framebuffers, and there is a set of them (and of recording pools) for every swap chain image.
+    createCommandBuffer(renderer);
+    if (nullptr != renderer.recordingThreads) {
+        uint32_t threadCount = renderer.recordingThreads->threadCount();
+        destroyRecordingThreads(renderer);
+        createRecordingThreads(renderer, threadCount);
+    }
 }
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -142,15 +150,18 @@ void initVulkan(Renderer::Context& renderer) {
     createImageViews(renderer);
     createRenderPass(renderer);
     createDescriptorSetLayout(renderer);
-    createGraphicsPipeline(renderer);
+    createPipelineCache(renderer);
+    {
+        Timer(pipelineTime, "createGraphicsPipeline"); // the part of the startup the pipeline cache shortens.
+        createGraphicsPipeline(renderer);
+    }
     createCommandPool(renderer);
     createTextureImage(renderer);
     createTextureImageView(renderer);
     createTextureSampler(renderer);
     createDepthResources(renderer);
     createFramebuffers(renderer);
-    createVertexBuffer(renderer);
-    createIndexBuffer(renderer);
+    createStreamBuffer(renderer, STREAM_BUFFER_FRAME_SIZE);
     createUniformBuffers(renderer);
     createDescriptorPool(renderer);
     createDescriptorSets(renderer);
@@ -355,15 +366,20 @@ QueueFamilyIndices findQueueFamilies(Renderer::Context& renderer, VkPhysicalDevi
     for (const auto& queueFamily : queueFamilies) {
 
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
+            if (!indices.graphicsFamily.has_value()) {
+                indices.graphicsFamily = i;
+            }
+        }
+        else if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) {
+            // a family without compute as well is the copy engine itself, so it is preferred.
+            if (!indices.transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+                indices.transferFamily = i;
+            }
         }
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, renderer.vk_surface, &presentSupport);
-        if (presentSupport) {
+        if (presentSupport && !indices.presentFamily.has_value()) {
             indices.presentFamily = i;
         }
-        if (indices.isComplete()) {
-            break;
-        }
 
         i++;
     }
@@ -401,6 +417,9 @@ void createLogicalDevice(Renderer::Context& renderer) {
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
 
     float queuePriority = 1.0f;
 
@@ -423,6 +442,16 @@ void createLogicalDevice(Renderer::Context& renderer) {
         deviceFeatures.fillModeNonSolid = VK_TRUE;
     }
 
+    // without it 32 bit indices only go up to 2^24 - 1 (maxDrawIndexedIndexValue).
+    if (supportedFeatures.fullDrawIndexUint32) {
+        deviceFeatures.fullDrawIndexUint32 = VK_TRUE;
+    }
+
+    renderer.vk_multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    renderer.vk_drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -443,6 +472,15 @@ void createLogicalDevice(Renderer::Context& renderer) {
 
     vkGetDeviceQueue(renderer.vk_device, indices.presentFamily.value(), 0, &renderer.vk_presentQueue);
     vkGetDeviceQueue(renderer.vk_device, indices.graphicsFamily.value(), 0, &renderer.vk_graphicsQueue);
+
+    renderer.vk_graphicsQueueFamily = indices.graphicsFamily.value();
+    renderer.vk_transferQueueFamily = indices.transferFamily.value_or(renderer.vk_graphicsQueueFamily);
+    vkGetDeviceQueue(renderer.vk_device, renderer.vk_transferQueueFamily, 0, &renderer.vk_transferQueue);
+    if (indices.transferFamily.has_value()) {
+        logRecord("Uploads use the dedicated transfer queue family " + std::to_string(renderer.vk_transferQueueFamily) + ".", logLevelInfo);
+    }
+
+    renderer.vk_memoryAllocator.init(renderer.vk_physicalDevice, renderer.vk_device);
 };
 
 void createSwapChain(Renderer::Context& renderer) {
@@ -580,20 +618,7 @@ void createRenderPass(Renderer::Context& renderer) {
     }
 }
 
-uint32_t findMemoryType(Renderer::Context& renderer, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(renderer.vk_physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throwError("failed to find suitable memory type!", logLevelError);
-}
-
-void createImage(Renderer::Context& renderer, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void createImage(Renderer::Context& renderer, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GpuAllocation& imageAllocation) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -616,21 +641,22 @@ void createImage(Renderer::Context& renderer, uint32_t width, uint32_t height, V
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(renderer.vk_device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(renderer, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(renderer.vk_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+    if (!renderer.vk_memoryAllocator.allocate(memRequirements, properties, VK_IMAGE_TILING_LINEAR == tiling, imageAllocation)) {
         throw std::runtime_error("failed to allocate image memory!");
     }
 
-    vkBindImageMemory(renderer.vk_device, image, imageMemory, 0);
+    vkBindImageMemory(renderer.vk_device, image, imageAllocation.memory, imageAllocation.offset);
+}
+
+void destroyImage(Renderer::Context& renderer, VkImage& image, GpuAllocation& imageAllocation) {
+    vkDestroyImage(renderer.vk_device, image, nullptr);
+    renderer.vk_memoryAllocator.free(imageAllocation);
+    image = VK_NULL_HANDLE;
 }
 
 void createDepthResources(Renderer::Context& renderer) {
     VkFormat depthFormat = findDepthFormat(renderer);
-    createImage(renderer, renderer.vk_swapChainExtent.width, renderer.vk_swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_depthImage, renderer.vk_depthImageMemory);
+    createImage(renderer, renderer.vk_swapChainExtent.width, renderer.vk_swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_depthImage, renderer.vk_depthImageAllocation);
     renderer.vk_depthImageView = createImageView(renderer, renderer.vk_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 }
@@ -668,25 +694,17 @@ void createTextureImage(Renderer::Context& renderer) {
         throwError("failed to load texture image!", logLevelError);
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(renderer, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(renderer.vk_device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(renderer.vk_device, stagingBufferMemory);
+    UploadBatch batch = beginUploadBatch(renderer);
+    VkBuffer stagingBuffer = createStagingBuffer(renderer, batch, pixels, imageSize);
 
     stbi_image_free(pixels);
 
-    createImage(renderer, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_textureImage, renderer.vk_textureImageMemory);
+    createImage(renderer, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_textureImage, renderer.vk_textureImageAllocation);
+    copyBufferToImage(renderer, batch, stagingBuffer, renderer.vk_textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
-    transitionImageLayout(renderer, renderer.vk_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(renderer, stagingBuffer, renderer.vk_textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-
-    transitionImageLayout(renderer, renderer.vk_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    vkDestroyBuffer(renderer.vk_device, stagingBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, stagingBufferMemory, nullptr);
+    // the rest of init goes on while the texture uploads, the first frame waits for it.
+    submitUploadBatch(renderer, batch);
+    renderer.vk_pendingUploads.push_back(batch);
 
 }
 
@@ -717,7 +735,7 @@ void createTextureSampler(Renderer::Context& renderer) {
     }
 }
 
-void createBuffer(Renderer::Context& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void createBuffer(Renderer::Context& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GpuAllocation& bufferAllocation) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -731,27 +749,30 @@ void createBuffer(Renderer::Context& renderer, VkDeviceSize size, VkBufferUsageF
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(renderer.vk_device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(renderer, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(renderer.vk_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+    if (!renderer.vk_memoryAllocator.allocate(memRequirements, properties, true, bufferAllocation)) {
         throw std::runtime_error("failed to allocate buffer memory!");
     }
 
-    vkBindBufferMemory(renderer.vk_device, buffer, bufferMemory, 0);
+    vkBindBufferMemory(renderer.vk_device, buffer, bufferAllocation.memory, bufferAllocation.offset);
 }
 
-VkCommandBuffer beginSingleTimeCommands(Renderer::Context& renderer) {
+void destroyBuffer(Renderer::Context& renderer, VkBuffer& buffer, GpuAllocation& bufferAllocation) {
+    vkDestroyBuffer(renderer.vk_device, buffer, nullptr);
+    renderer.vk_memoryAllocator.free(bufferAllocation);
+    buffer = VK_NULL_HANDLE;
+}
+
+static VkCommandBuffer allocateUploadCommands(Renderer::Context& renderer, VkCommandPool commandPool) {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = renderer.vk_commandPool;
+    allocInfo.commandPool = commandPool;
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(renderer.vk_device, &allocInfo, &commandBuffer);
+    if (vkAllocateCommandBuffers(renderer.vk_device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throwError("failed to allocate upload command buffer!", logLevelError);
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -762,22 +783,75 @@ VkCommandBuffer beginSingleTimeCommands(Renderer::Context& renderer) {
     return commandBuffer;
 }
 
-void endSingleTimeCommands(Renderer::Context& renderer, VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
+UploadBatch beginUploadBatch(Renderer::Context& renderer) {
+    UploadBatch batch;
+    batch.transferCommands = allocateUploadCommands(renderer, renderer.vk_transferCommandPool);
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    // with a dedicated transfer queue, what it writes has to be released by it and acquired by the graphics queue before it can be used there.
+    if (renderer.vk_transferQueueFamily != renderer.vk_graphicsQueueFamily) {
+        batch.acquireCommands = allocateUploadCommands(renderer, renderer.vk_commandPool);
 
-    vkQueueSubmit(renderer.vk_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(renderer.vk_graphicsQueue);
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(renderer.vk_device, &semaphoreInfo, nullptr, &batch.transferFinished) != VK_SUCCESS) {
+            throwError("failed to create upload semaphore!", logLevelError);
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(renderer.vk_device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+        throwError("failed to create upload fence!", logLevelError);
+    }
+
+    return batch;
+}
+
+VkBuffer createStagingBuffer(Renderer::Context& renderer, UploadBatch& batch, const void* data, VkDeviceSize size) {
+    VkBuffer stagingBuffer;
+    GpuAllocation stagingBufferAllocation;
+    createBuffer(renderer, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferAllocation);
+
+    memcpy(stagingBufferAllocation.mapped, data, static_cast<size_t>(size));
+
+    batch.buffersToFree.push_back(stagingBuffer);
+    batch.allocationsToFree.push_back(stagingBufferAllocation);
+    return stagingBuffer;
+}
+
+void copyBuffer(Renderer::Context& renderer, UploadBatch& batch, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset) {
+    VkBufferCopy copyRegion{};
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.transferCommands, srcBuffer, dstBuffer, 1, &copyRegion);
+
+    if (VK_NULL_HANDLE == batch.acquireCommands) {
+        return; // submitting on the graphics queue with a fence is enough, nothing reads the buffer before the batch is finished.
+    }
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = renderer.vk_transferQueueFamily;
+    barrier.dstQueueFamilyIndex = renderer.vk_graphicsQueueFamily;
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    // release
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 
-    vkFreeCommandBuffers(renderer.vk_device, renderer.vk_commandPool, 1, &commandBuffer);
+    // acquire
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(batch.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 }
 
-void copyBufferToImage(Renderer::Context& renderer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(renderer);
+void copyBufferToImage(Renderer::Context& renderer, UploadBatch& batch, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
+    VkCommandBuffer commandBuffer = batch.transferCommands;
+
+    transitionImageLayout(commandBuffer, image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
@@ -805,12 +879,120 @@ void copyBufferToImage(Renderer::Context& renderer, VkBuffer buffer, VkImage ima
         &region
     );
 
-    endSingleTimeCommands(renderer, commandBuffer);
+    if (VK_NULL_HANDLE == batch.acquireCommands) {
+        transitionImageLayout(commandBuffer, image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        return;
+    }
+
+    // the layout changes as part of the ownership transfer, the transfer queue cannot wait on fragment shaders itself.
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = renderer.vk_transferQueueFamily;
+    barrier.dstQueueFamilyIndex = renderer.vk_graphicsQueueFamily;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // release
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    // acquire
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(batch.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void submitUploadBatch(Renderer::Context& renderer, UploadBatch& batch) {
+    vkEndCommandBuffer(batch.transferCommands);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.transferCommands;
+
+    if (VK_NULL_HANDLE == batch.acquireCommands) {
+        if (vkQueueSubmit(renderer.vk_transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throwError("failed to submit upload command buffer!", logLevelError);
+        }
+        batch.submitted = true;
+        return;
+    }
+
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &batch.transferFinished;
+    if (vkQueueSubmit(renderer.vk_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throwError("failed to submit upload command buffer!", logLevelError);
+    }
+
+    vkEndCommandBuffer(batch.acquireCommands);
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo acquireInfo{};
+    acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireInfo.waitSemaphoreCount = 1;
+    acquireInfo.pWaitSemaphores = &batch.transferFinished;
+    acquireInfo.pWaitDstStageMask = &waitStage;
+    acquireInfo.commandBufferCount = 1;
+    acquireInfo.pCommandBuffers = &batch.acquireCommands;
+
+    // the fence is signalled by the acquire, so a finished batch is also ready to be used by the graphics queue.
+    if (vkQueueSubmit(renderer.vk_graphicsQueue, 1, &acquireInfo, batch.fence) != VK_SUCCESS) {
+        throwError("failed to submit upload acquire command buffer!", logLevelError);
+    }
+    batch.submitted = true;
+}
+
+static void freeUploadBatch(Renderer::Context& renderer, UploadBatch& batch) {
+    for (size_t i = 0; i < batch.buffersToFree.size(); i++) {
+        destroyBuffer(renderer, batch.buffersToFree[i], batch.allocationsToFree[i]);
+    }
+    batch.buffersToFree.clear();
+    batch.allocationsToFree.clear();
+
+    vkFreeCommandBuffers(renderer.vk_device, renderer.vk_transferCommandPool, 1, &batch.transferCommands);
+    if (VK_NULL_HANDLE != batch.acquireCommands) {
+        vkFreeCommandBuffers(renderer.vk_device, renderer.vk_commandPool, 1, &batch.acquireCommands);
+        vkDestroySemaphore(renderer.vk_device, batch.transferFinished, nullptr);
+    }
+    vkDestroyFence(renderer.vk_device, batch.fence, nullptr);
+
+    batch = UploadBatch();
 }
 
-void transitionImageLayout(Renderer::Context& renderer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(renderer);
+bool uploadBatchFinished(Renderer::Context& renderer, UploadBatch& batch) {
+    if (!batch.submitted) {
+        return VK_NULL_HANDLE == batch.fence; // a batch that was already freed counts as finished.
+    }
+    if (vkGetFenceStatus(renderer.vk_device, batch.fence) != VK_SUCCESS) {
+        return false;
+    }
+    freeUploadBatch(renderer, batch);
+    return true;
+}
+
+void waitForUploadBatch(Renderer::Context& renderer, UploadBatch& batch) {
+    if (!batch.submitted) {
+        return;
+    }
+    vkWaitForFences(renderer.vk_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    freeUploadBatch(renderer, batch);
+}
 
+void waitForPendingUploads(Renderer::Context& renderer) {
+    for (UploadBatch& batch : renderer.vk_pendingUploads) {
+        waitForUploadBatch(renderer, batch);
+    }
+    renderer.vk_pendingUploads.clear();
+}
+
+void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -856,117 +1038,191 @@ void transitionImageLayout(Renderer::Context& renderer, VkImage image, VkFormat
         0, nullptr,
         1, &barrier
     );
-
-    endSingleTimeCommands(renderer, commandBuffer);
 }
 
-void copyBuffer(Renderer::Context& renderer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(renderer);
-
-    VkBufferCopy copyRegion{};
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    endSingleTimeCommands(renderer, commandBuffer);
+void createStreamBuffer(Renderer::Context& renderer, VkDeviceSize frameSize) {
+    renderer.vk_streamFrameSize = (frameSize + 255) & ~(VkDeviceSize)255; // every frame's part starts 256 aligned, which covers any offset the buffer is bound at.
+    VkDeviceSize bufferSize = renderer.vk_streamFrameSize * MAX_FRAMES_IN_FLIGHT;
 
+    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, renderer.vk_streamBuffer, renderer.vk_streamBufferAllocation);
+    renderer.vk_streamBufferMapped = (char*)renderer.vk_streamBufferAllocation.mapped; // host visible memory stays mapped for as long as it is allocated.
 }
 
-void updateVertexBuffer(Renderer::Context& renderer) {
-    VkDeviceSize bufferSize = sizeof(renderer.vertices[0]) * renderer.vertices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+void destroyStreamBuffer(Renderer::Context& renderer) {
+    destroyBuffer(renderer, renderer.vk_streamBuffer, renderer.vk_streamBufferAllocation);
+    renderer.vk_streamBufferMapped = nullptr;
+}
 
-    void* data;
-    vkMapMemory(renderer.vk_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, renderer.vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderer.vk_device, stagingBufferMemory);
-    
-    vkQueueWaitIdle(renderer.vk_graphicsQueue);
-    vkDestroyBuffer(renderer.vk_device, renderer.vk_vertexBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_vertexBufferMemory, nullptr);
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_vertexBuffer, renderer.vk_vertexBufferMemory);
+void updateStreamBuffer(Renderer::Context& renderer) {
+    VkDeviceSize vertexSize = sizeof(Vertex) * renderer.vertices.size();
+    VkIndexType indexType = indexTypeFor(renderer.vertices.size());
+    VkDeviceSize indexSize = indexSizeOf(indexType) * renderer.indices.size();
+    VkDeviceSize indexStart = (vertexSize + 3) & ~(VkDeviceSize)3; // the index offset has to be a multiple of the index size.
+    VkDeviceSize instanceSize = sizeof(InstanceData) * (renderer.instances.size() + 1);
+    VkDeviceSize instanceStart = (indexStart + indexSize + 15) & ~(VkDeviceSize)15;
+    VkDeviceSize indirectSize = sizeof(VkDrawIndexedIndirectCommand) * renderer.drawItems.size();
+    VkDeviceSize indirectStart = instanceStart + instanceSize; // instances are a multiple of 4 bytes, as indirect commands have to be.
+
+    // sorted by what has to be bound for them, the only pipeline state that changes between draw items is the pipeline (culling or not), the index buffer and the flat shading.
+    std::stable_sort(renderer.drawItems.begin(), renderer.drawItems.end(), [](const DrawItem& lhs, const DrawItem& rhs) {
+        if (lhs.doubleSided != rhs.doubleSided) {
+            return lhs.doubleSided < rhs.doubleSided;
+        }
+        if (lhs.indexType != rhs.indexType) {
+            return lhs.indexType < rhs.indexType;
+        }
+        return lhs.flatShade < rhs.flatShade;
+    });
+
+    renderer.drawBatches.clear();
+    for (uint32_t index = 0; index < renderer.drawItems.size(); index++) {
+        DrawItem& item = renderer.drawItems[index];
+        if (renderer.drawBatches.empty() || renderer.drawBatches.back().indexType != item.indexType || renderer.drawBatches.back().flatShade != item.flatShade
+            || renderer.drawBatches.back().doubleSided != item.doubleSided) {
+            renderer.drawBatches.push_back({ item.indexType, item.flatShade, item.doubleSided, index, 0 });
+        }
+        renderer.drawBatches.back().commandCount++;
+    }
 
-    copyBuffer(renderer, stagingBuffer, renderer.vk_vertexBuffer, bufferSize);
+    if (indirectStart + indirectSize > renderer.vk_streamFrameSize) {
+        // only happens when a frame needs more than any frame before it. The other part may still be read by the gpu, so this is the one place that waits for it.
+        VkDeviceSize neededSize = indirectStart + indirectSize;
+        vkDeviceWaitIdle(renderer.vk_device);
+        destroyStreamBuffer(renderer);
+        createStreamBuffer(renderer, neededSize + neededSize / 2);
+        invalidateCommandBuffers(renderer); // they all read from the old buffer.
+    }
 
-    vkDestroyBuffer(renderer.vk_device, stagingBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, stagingBufferMemory, nullptr);
-}
+    VkDeviceSize frameStart = renderer.vk_streamFrameSize * currentFrame;
+    if (vertexSize > 0) {
+        memcpy(renderer.vk_streamBufferMapped + frameStart, renderer.vertices.data(), (size_t)vertexSize);
+    }
+    if (VK_INDEX_TYPE_UINT16 == indexType) {
+        uint16_t* shortIndices = (uint16_t*)(renderer.vk_streamBufferMapped + frameStart + indexStart);
+        for (size_t index = 0; index < renderer.indices.size(); index++) {
+            shortIndices[index] = (uint16_t)renderer.indices[index];
+        }
+    }
+    else if (indexSize > 0) {
+        memcpy(renderer.vk_streamBufferMapped + frameStart + indexStart, renderer.indices.data(), (size_t)indexSize);
+    }
 
-void updateIndexBuffer(Renderer::Context& renderer) {
-    VkDeviceSize bufferSize = sizeof(renderer.indices[0]) * renderer.indices.size();
+    const InstanceData identity;
+    memcpy(renderer.vk_streamBufferMapped + frameStart + instanceStart, &identity, sizeof(InstanceData));
+    if (!renderer.instances.empty()) {
+        memcpy(renderer.vk_streamBufferMapped + frameStart + instanceStart + sizeof(InstanceData), renderer.instances.data(), (size_t)(instanceSize - sizeof(InstanceData)));
+    }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    VkDrawIndexedIndirectCommand* commands = (VkDrawIndexedIndirectCommand*)(renderer.vk_streamBufferMapped + frameStart + indirectStart);
+    for (size_t index = 0; index < renderer.drawItems.size(); index++) {
+        DrawItem& item = renderer.drawItems[index];
+        commands[index] = { item.indexCount, item.instanceCount, item.firstIndex, item.vertexOffset, item.firstInstance + 1 }; // + 1 skips the identity instance.
+    }
 
-    void* data;
-    vkMapMemory(renderer.vk_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, renderer.indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderer.vk_device, stagingBufferMemory);
-    vkQueueWaitIdle(renderer.vk_graphicsQueue);
-    vkDestroyBuffer(renderer.vk_device, renderer.vk_indexBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_indexBufferMemory, nullptr);
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_indexBuffer, renderer.vk_indexBufferMemory);
+    renderer.vk_streamVertexOffset = frameStart;
+    renderer.vk_streamIndexOffset = frameStart + indexStart;
+    renderer.vk_streamIndexCount = static_cast<uint32_t>(renderer.indices.size());
+    renderer.vk_streamIndexType = indexType;
+    renderer.vk_streamInstanceOffset = frameStart + instanceStart;
+    renderer.vk_streamIndirectOffset = frameStart + indirectStart;
+}
 
-    copyBuffer(renderer, stagingBuffer, renderer.vk_indexBuffer, bufferSize);
+// copies what was added to the end of the geometry's data to its buffer. A buffer that is too small is made again twice as big and filled from the copy it keeps,
+// the old one is handed to the batch and freed when the batch has finished, without waiting for the gpu here.
+static void uploadMeshGeometry(Renderer::Context& renderer, UploadBatch& batch, MeshGeometry& geometry, VkDeviceSize addedSize, VkBufferUsageFlags usage) {
+    VkDeviceSize uploadStart = geometry.data.size() - addedSize;
+
+    if (geometry.data.size() > geometry.capacity) {
+        // the batch may already copy into the old buffer (an earlier mesh added to it) and frames in flight may draw from it,
+        // so it is freed with the batch, whose fence comes after both.
+        if (VK_NULL_HANDLE != geometry.buffer) {
+            batch.buffersToFree.push_back(geometry.buffer);
+            batch.allocationsToFree.push_back(geometry.allocation);
+            geometry.buffer = VK_NULL_HANDLE;
+        }
+        geometry.capacity = std::max<VkDeviceSize>(geometry.capacity * 2, std::max<VkDeviceSize>(geometry.data.size(), 1 << 16));
+        createBuffer(renderer, geometry.capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, geometry.buffer, geometry.allocation);
+        invalidateCommandBuffers(renderer);
+        uploadStart = 0;
+    }
 
-    vkDestroyBuffer(renderer.vk_device, stagingBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, stagingBufferMemory, nullptr);
+    VkDeviceSize uploadSize = geometry.data.size() - uploadStart;
+    if (uploadSize > 0) {
+        VkBuffer staging = createStagingBuffer(renderer, batch, geometry.data.data() + uploadStart, uploadSize);
+        copyBuffer(renderer, batch, staging, geometry.buffer, uploadSize, uploadStart);
+    }
 }
 
-void createVertexBuffer(Renderer::Context& renderer) {
-    VkDeviceSize bufferSize = sizeof(renderer.vertices[0]) * renderer.vertices.size();
+uint32_t Renderer::addMesh(Renderer::Context& renderer, UploadBatch& batch, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+    GpuMesh mesh;
+    mesh.indexCount = indexCount;
+    mesh.indexType = indexTypeFor(vertexCount); // the indices are relative to the mesh, the vertex offset moves them to where its vertices are.
+    mesh.vertexOffset = static_cast<int32_t>(renderer.vk_meshVertices.data.size() / sizeof(Vertex));
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    MeshGeometry& indexGeometry = VK_INDEX_TYPE_UINT16 == mesh.indexType ? renderer.vk_meshIndices16 : renderer.vk_meshIndices32;
+    VkDeviceSize indexSize = indexSizeOf(mesh.indexType);
+    mesh.firstIndex = static_cast<uint32_t>(indexGeometry.data.size() / indexSize);
 
-    void* data;
-    vkMapMemory(renderer.vk_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, renderer.vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderer.vk_device, stagingBufferMemory);
+    const char* vertexBytes = (const char*)vertices;
+    renderer.vk_meshVertices.data.insert(renderer.vk_meshVertices.data.end(), vertexBytes, vertexBytes + sizeof(Vertex) * vertexCount);
 
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_vertexBuffer, renderer.vk_vertexBufferMemory);
-
-    copyBuffer(renderer, stagingBuffer, renderer.vk_vertexBuffer, bufferSize);
+    if (VK_INDEX_TYPE_UINT16 == mesh.indexType) {
+        std::vector<uint16_t> shortIndices(indices, indices + indexCount);
+        const char* indexBytes = (const char*)shortIndices.data();
+        indexGeometry.data.insert(indexGeometry.data.end(), indexBytes, indexBytes + indexSize * indexCount);
+    }
+    else {
+        const char* indexBytes = (const char*)indices;
+        indexGeometry.data.insert(indexGeometry.data.end(), indexBytes, indexBytes + indexSize * indexCount);
+    }
 
-    vkDestroyBuffer(renderer.vk_device, stagingBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, stagingBufferMemory, nullptr);
+    uploadMeshGeometry(renderer, batch, renderer.vk_meshVertices, sizeof(Vertex) * vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    uploadMeshGeometry(renderer, batch, indexGeometry, indexSize * indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
+    renderer.gpuMeshes.push_back(mesh);
+    return static_cast<uint32_t>(renderer.gpuMeshes.size() - 1);
 }
 
-void createIndexBuffer(Renderer::Context& renderer) {
-    VkDeviceSize bufferSize = sizeof(renderer.indices[0]) * renderer.indices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(renderer.vk_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, renderer.indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderer.vk_device, stagingBufferMemory);
+void Renderer::drawMesh(Renderer::Context& renderer, uint32_t mesh, const Mat4& transform, bool flatShade, bool doubleSided) {
+    InstanceData instance;
+    instance.transform = transform;
+    drawMeshInstanced(renderer, mesh, Mat4(), &instance, 1, flatShade, doubleSided);
+}
 
-    createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, renderer.vk_indexBuffer, renderer.vk_indexBufferMemory);
+void Renderer::drawMeshInstanced(Renderer::Context& renderer, uint32_t mesh, const Mat4& transform, const InstanceData* instances, uint32_t instanceCount, bool flatShade, bool doubleSided) {
+    if (0 == instanceCount) {
+        return;
+    }
+    GpuMesh& gpuMesh = renderer.gpuMeshes[mesh];
+    uint32_t firstInstance = static_cast<uint32_t>(renderer.instances.size());
 
-    copyBuffer(renderer, stagingBuffer, renderer.vk_indexBuffer, bufferSize);
+    // a draw's transform has to go into its instances, as all the draws of a batch share one set of push constants.
+    const Mat4 identity;
+    if (0 == memcmp(transform.m, identity.m, sizeof(identity.m))) {
+        renderer.instances.insert(renderer.instances.end(), instances, instances + instanceCount);
+    }
+    else {
+        for (uint32_t index = 0; index < instanceCount; index++) {
+            InstanceData instance = instances[index];
+            instance.transform = transform * instance.transform;
+            renderer.instances.push_back(instance);
+        }
+    }
 
-    vkDestroyBuffer(renderer.vk_device, stagingBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, stagingBufferMemory, nullptr);
+    renderer.drawItems.push_back({ gpuMesh.firstIndex, gpuMesh.indexCount, gpuMesh.vertexOffset, firstInstance, instanceCount, gpuMesh.indexType, flatShade, doubleSided });
 }
+
 void createUniformBuffers(Renderer::Context& renderer) {
     VkDeviceSize bufferSize = sizeof(Renderer::Context::UniformBufferObject);
 
     renderer.vk_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    renderer.vk_uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    renderer.vk_uniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
     renderer.vk_uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, renderer.vk_uniformBuffers[i], renderer.vk_uniformBuffersMemory[i]);
+        createBuffer(renderer, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, renderer.vk_uniformBuffers[i], renderer.vk_uniformBuffersAllocation[i]);
 
-        vkMapMemory(renderer.vk_device, renderer.vk_uniformBuffersMemory[i], 0, bufferSize, 0, &renderer.vk_uniformBuffersMapped[i]);
+        renderer.vk_uniformBuffersMapped[i] = renderer.vk_uniformBuffersAllocation[i].mapped;
     }
 }
 
@@ -1040,6 +1296,44 @@ void createDescriptorSetLayout(Renderer::Context& renderer) {
     }
 }
 
+// reads which locations the shader's Input variables are decorated with straight from the SPIR-V, to catch a vert.spv that was not rebuilt
+// after an attribute was added to the pipeline (vulkan lets the pipeline feed attributes the shader never reads, so it would draw without them).
+static void checkShaderInputs(const std::vector<char>& code, const std::vector<VkVertexInputAttributeDescription>& attributes, const char* shaderName) {
+    const uint32_t opDecorate = 71;
+    const uint32_t opVariable = 59;
+    const uint32_t decorationLocation = 30;
+    const uint32_t storageClassInput = 1;
+
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(code.data());
+    size_t wordCount = code.size() / sizeof(uint32_t);
+
+    std::unordered_map<uint32_t, uint32_t> locationOfId;
+    std::vector<uint32_t> inputLocations;
+    for (size_t index = 5; index < wordCount;) { // the header is 5 words.
+        uint32_t instructionLength = words[index] >> 16;
+        uint32_t opcode = words[index] & 0xffff;
+        if (0 == instructionLength || index + instructionLength > wordCount) {
+            break;
+        }
+        if (opDecorate == opcode && instructionLength >= 4 && decorationLocation == words[index + 2]) {
+            locationOfId[words[index + 1]] = words[index + 3];
+        }
+        else if (opVariable == opcode && instructionLength >= 4 && storageClassInput == words[index + 3]) {
+            auto location = locationOfId.find(words[index + 2]);
+            if (location != locationOfId.end()) {
+                inputLocations.push_back(location->second);
+            }
+        }
+        index += instructionLength;
+    }
+
+    for (const VkVertexInputAttributeDescription& attribute : attributes) {
+        if (std::find(inputLocations.begin(), inputLocations.end(), attribute.location) == inputLocations.end()) {
+            throwError(std::string(shaderName) + " has no input at location " + std::to_string(attribute.location) + ", it is older than the shader source, run compile.bat.", logLevelError);
+        }
+    }
+}
+
 void createGraphicsPipeline(Renderer::Context& renderer) {
     auto vertShaderCode = readFile("src/Renderer/Shaders/vert.spv");
     auto fragShaderCode = readFile("src/Renderer/Shaders/frag.spv");
@@ -1064,12 +1358,20 @@ void createGraphicsPipeline(Renderer::Context& renderer) {
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Vertex::getBindingDescription(), InstanceData::getBindingDescription() };
 
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    for (auto& attributeDescription : Vertex::getAttributeDescriptions()) {
+        attributeDescriptions.push_back(attributeDescription);
+    }
+    for (auto& attributeDescription : InstanceData::getAttributeDescriptions()) {
+        attributeDescriptions.push_back(attributeDescription);
+    }
+    checkShaderInputs(vertShaderCode, attributeDescriptions, "vert.spv");
+
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 
@@ -1164,8 +1466,14 @@ void createGraphicsPipeline(Renderer::Context& renderer) {
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &renderer.vk_descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MeshPushConstants);
+
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
     if (vkCreatePipelineLayout(renderer.vk_device, &pipelineLayoutInfo, nullptr, &renderer.vk_pipelineLayout) != VK_SUCCESS) {
         throwError("failed to create pipeline layout!", logLevelError);
@@ -1190,15 +1498,124 @@ void createGraphicsPipeline(Renderer::Context& renderer) {
     pipelineInfo.basePipelineIndex = -1; // Optional
     pipelineInfo.pDepthStencilState = &depthStencil;
 
-    if (vkCreateGraphicsPipelines(renderer.vk_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &renderer.vk_graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(renderer.vk_device, renderer.vk_pipelineCache, 1, &pipelineInfo, nullptr, &renderer.vk_graphicsPipeline) != VK_SUCCESS) {
         throwError("failed to create graphics pipeline!", logLevelError);
     }
 
+    // the one for double sided meshes only differs in the culling.
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    if (vkCreateGraphicsPipelines(renderer.vk_device, renderer.vk_pipelineCache, 1, &pipelineInfo, nullptr, &renderer.vk_doubleSidedPipeline) != VK_SUCCESS) {
+        throwError("failed to create double sided graphics pipeline!", logLevelError);
+    }
+
     vkDestroyShaderModule(renderer.vk_device, fragShaderModule, nullptr);
     vkDestroyShaderModule(renderer.vk_device, vertShaderModule, nullptr);
 };
 
 
+// a file is only used if it was written for the same device and driver, a driver given a cache of another one may reject it, or worse, crash on it.
+static bool pipelineCacheFileValid(const VkPhysicalDeviceProperties& properties, const std::vector<char>& contents) {
+    if (contents.size() < sizeof(PipelineCacheFileHeader)) {
+        return false;
+    }
+    PipelineCacheFileHeader header;
+    memcpy(&header, contents.data(), sizeof(header));
+
+    if (PIPELINE_CACHE_FILE_MAGIC != header.magic || header.dataSize != contents.size() - sizeof(header)
+        || header.vendorID != properties.vendorID || header.deviceID != properties.deviceID || header.driverVersion != properties.driverVersion
+        || 0 != memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE)) {
+        return false;
+    }
+
+    // the header vulkan puts in front of its own data (VkPipelineCacheHeaderVersionOne), in case the file was edited or written by something else.
+    const char* data = contents.data() + sizeof(header);
+    uint32_t vulkanHeader[4];
+    if (header.dataSize < sizeof(vulkanHeader) + VK_UUID_SIZE) {
+        return false;
+    }
+    memcpy(vulkanHeader, data, sizeof(vulkanHeader));
+    return vulkanHeader[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && vulkanHeader[2] == properties.vendorID && vulkanHeader[3] == properties.deviceID
+        && 0 == memcmp(data + sizeof(vulkanHeader), properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+void createPipelineCache(Renderer::Context& renderer) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(renderer.vk_physicalDevice, &properties);
+
+    std::vector<char> contents;
+    std::ifstream file(PIPELINE_CACHE_FILE, std::ios::ate | std::ios::binary);
+    if (file.is_open()) {
+        contents.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(contents.data(), contents.size());
+        file.close();
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (pipelineCacheFileValid(properties, contents)) {
+        cacheInfo.initialDataSize = contents.size() - sizeof(PipelineCacheFileHeader);
+        cacheInfo.pInitialData = contents.data() + sizeof(PipelineCacheFileHeader);
+        logRecord("Loaded the pipeline cache (" + std::to_string(cacheInfo.initialDataSize) + " bytes).", logLevelInfo);
+    }
+    else if (!contents.empty()) {
+        logRecord("The pipeline cache was written for another device or driver, starting with an empty one.", logLevelInfo);
+    }
+
+    if (vkCreatePipelineCache(renderer.vk_device, &cacheInfo, nullptr, &renderer.vk_pipelineCache) != VK_SUCCESS) {
+        // the driver may still turn the data down, the pipelines are then made from scratch as they were before there was a cache.
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(renderer.vk_device, &cacheInfo, nullptr, &renderer.vk_pipelineCache) != VK_SUCCESS) {
+            throwError("failed to create pipeline cache!", logLevelError);
+        }
+    }
+}
+
+void destroyPipelineCache(Renderer::Context& renderer) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(renderer.vk_physicalDevice, &properties);
+
+    size_t dataSize = 0;
+    std::vector<char> contents;
+    if (vkGetPipelineCacheData(renderer.vk_device, renderer.vk_pipelineCache, &dataSize, nullptr) == VK_SUCCESS && dataSize > 0) {
+        contents.resize(sizeof(PipelineCacheFileHeader) + dataSize);
+        if (vkGetPipelineCacheData(renderer.vk_device, renderer.vk_pipelineCache, &dataSize, contents.data() + sizeof(PipelineCacheFileHeader)) != VK_SUCCESS) {
+            contents.clear();
+        }
+    }
+
+    if (!contents.empty()) {
+        PipelineCacheFileHeader header{};
+        header.magic = PIPELINE_CACHE_FILE_MAGIC;
+        header.dataSize = (uint32_t)dataSize;
+        header.vendorID = properties.vendorID;
+        header.deviceID = properties.deviceID;
+        header.driverVersion = properties.driverVersion;
+        memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        memcpy(contents.data(), &header, sizeof(header));
+
+        // written next to the old file and then moved over it, so closing the engine halfway through never leaves half a cache behind.
+        std::string tempFile = std::string(PIPELINE_CACHE_FILE) + ".tmp";
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        if (file.is_open()) {
+            file.write(contents.data(), contents.size());
+            file.close();
+            std::remove(PIPELINE_CACHE_FILE);
+            if (0 != std::rename(tempFile.c_str(), PIPELINE_CACHE_FILE)) {
+                logRecord("Could not save the pipeline cache.", logLevelWarning);
+            }
+        }
+        else {
+            logRecord("Could not save the pipeline cache.", logLevelWarning);
+        }
+    }
+
+    vkDestroyPipelineCache(renderer.vk_device, renderer.vk_pipelineCache, nullptr);
+    renderer.vk_pipelineCache = VK_NULL_HANDLE;
+}
+
 void createFramebuffers(Renderer::Context& renderer) {
     renderer.vk_swapChainFramebuffers.resize(renderer.vk_swapChainImageViews.size());
 
@@ -1232,9 +1649,111 @@ void createCommandPool(Renderer::Context& renderer) {
     if (vkCreateCommandPool(renderer.vk_device, &poolInfo, nullptr, &renderer.vk_commandPool) != VK_SUCCESS) {
         throwError("failed to create command pool!", logLevelError);
     }
+
+    // upload command buffers are recorded once and freed when their batch finishes.
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = renderer.vk_transferQueueFamily;
+
+    if (vkCreateCommandPool(renderer.vk_device, &poolInfo, nullptr, &renderer.vk_transferCommandPool) != VK_SUCCESS) {
+        throwError("failed to create transfer command pool!", logLevelError);
+    }
+}
+
+// records the state the draws need and the draws of the items [firstItem, endItem) into a command buffer that is inside the render pass,
+// the streamed vertices are drawn too if drawStreamed is set.
+static void recordDraws(Renderer::Context& renderer, VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t endItem, bool drawStreamed) {
+    // the viewport, scissor and descriptor set stay bound when the pipeline changes, as both pipelines have the same layout and dynamic state.
+    VkPipeline boundPipeline = renderer.vk_graphicsPipeline;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(renderer.vk_swapChainExtent.width);
+    viewport.height = static_cast<float>(renderer.vk_swapChainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = renderer.vk_swapChainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer.vk_pipelineLayout, 0, 1, &renderer.vk_descriptorSets[currentFrame], 0, nullptr);
+
+    MeshPushConstants pushConstants{};
+    const Mat4 identity;
+
+    // every draw reads binding 1, the ones that are not instanced read the identity instance at its start.
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, &renderer.vk_streamBuffer, &renderer.vk_streamInstanceOffset);
+
+    // the streamed vertices are already where they are drawn and already lit. Their back faces were culled on the cpu (cullBackFaces), so what is
+    // left is drawn without culling, which leaves double sided meshes whole.
+    if (drawStreamed && renderer.vk_streamIndexCount > 0) {
+        boundPipeline = renderer.vk_doubleSidedPipeline;
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+        VkBuffer vertexBuffers[] = { renderer.vk_streamBuffer };
+        VkDeviceSize offsets[] = { renderer.vk_streamVertexOffset };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, renderer.vk_streamBuffer, renderer.vk_streamIndexOffset, renderer.vk_streamIndexType);
+
+        memcpy(pushConstants.model, identity.m, sizeof(pushConstants.model));
+        pushConstants.flatShade = 0;
+        vkCmdPushConstants(commandBuffer, renderer.vk_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+        vkCmdDrawIndexed(commandBuffer, renderer.vk_streamIndexCount, 1, 0, 0, 0);
+    }
+    // draw cmd, buffer // index count // instance count// first index // vertex offset // first Instance
+
+    // the draw items, a call per batch. Their instances hold their transforms, so the push constants only change with the batch's flat shading.
+    if (firstItem < endItem) {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &renderer.vk_meshVertices.buffer, &offset);
+        memcpy(pushConstants.model, identity.m, sizeof(pushConstants.model));
+    }
+
+    for (DrawBatch& batch : renderer.drawBatches) {
+        // only the part of the batch that is in this command buffer's range.
+        uint32_t firstCommand = std::max(batch.firstCommand, firstItem);
+        uint32_t endCommand = std::min(batch.firstCommand + batch.commandCount, endItem);
+        if (firstCommand >= endCommand) {
+            continue;
+        }
+
+        VkPipeline batchPipeline = batch.doubleSided ? renderer.vk_doubleSidedPipeline : renderer.vk_graphicsPipeline;
+        if (batchPipeline != boundPipeline) {
+            boundPipeline = batchPipeline;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+        }
+
+        MeshGeometry& indexGeometry = VK_INDEX_TYPE_UINT16 == batch.indexType ? renderer.vk_meshIndices16 : renderer.vk_meshIndices32;
+        vkCmdBindIndexBuffer(commandBuffer, indexGeometry.buffer, 0, batch.indexType);
+
+        pushConstants.flatShade = batch.flatShade ? 1 : 0;
+        vkCmdPushConstants(commandBuffer, renderer.vk_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+        VkDeviceSize commandOffset = renderer.vk_streamIndirectOffset + sizeof(VkDrawIndexedIndirectCommand) * firstCommand;
+        if (!renderer.vk_drawIndirectFirstInstance) {
+            for (uint32_t index = firstCommand; index < endCommand; index++) {
+                DrawItem& item = renderer.drawItems[index];
+                vkCmdDrawIndexed(commandBuffer, item.indexCount, item.instanceCount, item.firstIndex, item.vertexOffset, item.firstInstance + 1);
+            }
+        }
+        else if (renderer.vk_multiDrawIndirect) {
+            vkCmdDrawIndexedIndirect(commandBuffer, renderer.vk_streamBuffer, commandOffset, endCommand - firstCommand, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else {
+            for (uint32_t index = 0; index < endCommand - firstCommand; index++) {
+                vkCmdDrawIndexedIndirect(commandBuffer, renderer.vk_streamBuffer, commandOffset + sizeof(VkDrawIndexedIndirectCommand) * index, 1, sizeof(VkDrawIndexedIndirectCommand));
+            }
+        }
+    }
 }
 
 void recordCommandBuffer(Renderer::Context& renderer, VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    auto recordStart = std::chrono::steady_clock::now();
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0; // Optional
@@ -1258,41 +1777,68 @@ void recordCommandBuffer(Renderer::Context& renderer, VkCommandBuffer commandBuf
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer.vk_graphicsPipeline);
-    
-    VkBuffer vertexBuffers[] = { renderer.vk_vertexBuffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, renderer.vk_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    if (nullptr == renderer.recordingThreads) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordDraws(renderer, commandBuffer, 0, static_cast<uint32_t>(renderer.drawItems.size()), true);
+    }
+    else {
+        // every thread records a share of the draw items into its own secondary command buffer, the first one also draws the streamed vertices.
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // the secondary command buffers belong to the cached primary one, so they are kept for every frame in flight and swap chain image too.
+        uint32_t threadCount = renderer.recordingThreads->threadCount();
+        size_t cacheIndex = currentFrame * renderer.vk_swapChainImages.size() + imageIndex;
+        VkCommandPool* commandPools = &renderer.vk_recordCommandPools[cacheIndex * threadCount];
+        VkCommandBuffer* secondaryCommandBuffers = &renderer.vk_secondaryCommandBuffers[cacheIndex * threadCount];
+        uint64_t itemCount = renderer.drawItems.size();
+
+        renderer.recordingThreads->run([&](uint32_t thread) {
+            vkResetCommandPool(renderer.vk_device, commandPools[thread], 0); // the frame's fence has been waited on, so the gpu is done with what was recorded last time.
+
+            VkCommandBufferInheritanceInfo inheritanceInfo{};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = renderer.vk_renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = renderer.vk_swapChainFramebuffers[imageIndex];
+
+            VkCommandBufferBeginInfo secondaryBeginInfo{};
+            secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT; // not one time submit, the primary command buffer may be submitted again.
+            secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            if (vkBeginCommandBuffer(secondaryCommandBuffers[thread], &secondaryBeginInfo) != VK_SUCCESS) {
+                throwError("failed to begin recording secondary command buffer!", logLevelError);
+            }
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(renderer.vk_swapChainExtent.width);
-    viewport.height = static_cast<float>(renderer.vk_swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            uint32_t firstItem = static_cast<uint32_t>(itemCount * thread / threadCount);
+            uint32_t endItem = static_cast<uint32_t>(itemCount * (thread + 1) / threadCount);
+            recordDraws(renderer, secondaryCommandBuffers[thread], firstItem, endItem, 0 == thread);
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = renderer.vk_swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+            if (vkEndCommandBuffer(secondaryCommandBuffers[thread]) != VK_SUCCESS) {
+                throwError("failed to record secondary command buffer!", logLevelError);
+            }
+        });
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer.vk_pipelineLayout, 0, 1, &renderer.vk_descriptorSets[currentFrame], 0, nullptr);
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(renderer.indices.size()), 1, 0, 0, 0);
-    // draw cmd, buffer // index count // instance count// first index // vertex offset // first Instance
+        vkCmdExecuteCommands(commandBuffer, threadCount, secondaryCommandBuffers);
+    }
 
     vkCmdEndRenderPass(commandBuffer);
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throwError("failed to record command buffer!", logLevelError);
     }
+
+    renderer.lastRecordMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
 }
 
 void createCommandBuffer(Renderer::Context& renderer) {
 
-    renderer.vk_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    // called again when the swap chain is made again, as the number of images may have changed.
+    if (!renderer.vk_commandBuffers.empty()) {
+        vkFreeCommandBuffers(renderer.vk_device, renderer.vk_commandPool, (uint32_t)renderer.vk_commandBuffers.size(), renderer.vk_commandBuffers.data());
+    }
+
+    renderer.vk_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT * renderer.vk_swapChainImages.size());
+    renderer.vk_commandBufferVersions.assign(renderer.vk_commandBuffers.size(), NO_SCENE_VERSION);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1305,6 +1851,67 @@ void createCommandBuffer(Renderer::Context& renderer) {
     }
 }
 
+void invalidateCommandBuffers(Renderer::Context& renderer) {
+    std::fill(renderer.vk_commandBufferVersions.begin(), renderer.vk_commandBufferVersions.end(), NO_SCENE_VERSION);
+}
+
+void Renderer::markSceneChanged(Renderer::Context& renderer) {
+    renderer.sceneVersion++;
+}
+
+void createRecordingThreads(Renderer::Context& renderer, uint32_t threadCount) {
+    renderer.vk_recordCommandPools.resize(renderer.vk_commandBuffers.size() * threadCount);
+    renderer.vk_secondaryCommandBuffers.resize(renderer.vk_commandBuffers.size() * threadCount);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // the pools are reset as a whole, so their command buffers do not need to be reset on their own.
+    poolInfo.queueFamilyIndex = renderer.vk_graphicsQueueFamily;
+
+    for (size_t i = 0; i < renderer.vk_recordCommandPools.size(); i++) {
+        if (vkCreateCommandPool(renderer.vk_device, &poolInfo, nullptr, &renderer.vk_recordCommandPools[i]) != VK_SUCCESS) {
+            throwError("failed to create recording command pool!", logLevelError);
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = renderer.vk_recordCommandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(renderer.vk_device, &allocInfo, &renderer.vk_secondaryCommandBuffers[i]) != VK_SUCCESS) {
+            throwError("failed to allocate secondary command buffers!", logLevelError);
+        }
+    }
+
+    renderer.recordingThreads = new RecordingThreads();
+    renderer.recordingThreads->start(threadCount);
+}
+
+void destroyRecordingThreads(Renderer::Context& renderer) {
+    if (nullptr == renderer.recordingThreads) {
+        return;
+    }
+    delete renderer.recordingThreads;
+    renderer.recordingThreads = nullptr;
+
+    // destroying a pool frees its command buffers.
+    for (VkCommandPool commandPool : renderer.vk_recordCommandPools) {
+        vkDestroyCommandPool(renderer.vk_device, commandPool, nullptr);
+    }
+    renderer.vk_recordCommandPools.clear();
+    renderer.vk_secondaryCommandBuffers.clear();
+}
+
+void Renderer::setRecordThreadCount(Renderer::Context& renderer, uint32_t threadCount) {
+    vkDeviceWaitIdle(renderer.vk_device);
+    destroyRecordingThreads(renderer);
+    if (threadCount > 1) {
+        createRecordingThreads(renderer, threadCount);
+    }
+    invalidateCommandBuffers(renderer);
+}
+
 static std::vector<char> readFile(const std::string& filename) {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -1437,8 +2044,20 @@ void Renderer::runFrame(Renderer::Context& renderer) {
     }
 
     vkResetFences(renderer.vk_device, 1, &renderer.vk_inFlightFences[currentFrame]);
-    vkResetCommandBuffer(renderer.vk_commandBuffers[currentFrame], 0);
-    recordCommandBuffer(renderer, renderer.vk_commandBuffers[currentFrame], imageIndex);
+
+    // a command buffer recorded for this frame in flight and swap chain image at the current scene version is submitted again as it is.
+    // The stream buffer is left alone too, as its part for this frame already holds what that scene version writes.
+    size_t cacheIndex = currentFrame * renderer.vk_swapChainImages.size() + imageIndex;
+    VkCommandBuffer commandBuffer = renderer.vk_commandBuffers[cacheIndex];
+    if (renderer.vk_commandBufferVersions[cacheIndex] != renderer.sceneVersion) {
+        vkResetCommandBuffer(commandBuffer, 0);
+        updateStreamBuffer(renderer); // the fence above means the gpu is done with this frame's part of the stream buffer.
+        recordCommandBuffer(renderer, commandBuffer, imageIndex);
+        renderer.vk_commandBufferVersions[cacheIndex] = renderer.sceneVersion;
+    }
+    else {
+        renderer.lastRecordMilliseconds = 0;
+    }
 
     Renderer::Context::UniformBufferObject ubo{};
 
@@ -1465,12 +2084,14 @@ void Renderer::runFrame(Renderer::Context& renderer) {
     submitInfo.pWaitDstStageMask = waitStages;
 
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &renderer.vk_commandBuffers[currentFrame];
+    submitInfo.pCommandBuffers = &commandBuffer;
 
     VkSemaphore signalSemaphores[] = { renderer.vk_renderFinishedSemaphores[currentFrame] };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    waitForPendingUploads(renderer); // only blocks if the frame is drawn before its uploads have finished.
+
     if (vkQueueSubmit(renderer.vk_graphicsQueue, 1, &submitInfo, renderer.vk_inFlightFences[currentFrame]) != VK_SUCCESS) {
         throwError("failed to submit draw command buffer!", logLevelError);
     }
@@ -1497,47 +2118,38 @@ void Renderer::runFrame(Renderer::Context& renderer) {
     }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-
-    if (renderer.vertices.size() > 0 && renderer.indices.size() > 0) {
-        updateVertexBuffer(renderer);
-        updateIndexBuffer(renderer);
-    }
-}
-
-void Renderer::updateBuffer(Context& renderer) {
-    updateVertexBuffer(renderer);
-    updateIndexBuffer(renderer);
 }
 
 void Renderer::cleanupRenderer(Renderer::Context& renderer) {
 
     renderer.initialised = false;
 
+    waitForPendingUploads(renderer);
     cleanupSwapChain(renderer);
 
     vkDestroySampler(renderer.vk_device, renderer.vk_textureSampler, nullptr);
     vkDestroyImageView(renderer.vk_device, renderer.vk_textureImageView, nullptr);
 
-    vkDestroyImage(renderer.vk_device, renderer.vk_textureImage, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_textureImageMemory, nullptr);
+    destroyImage(renderer, renderer.vk_textureImage, renderer.vk_textureImageAllocation);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroyBuffer(renderer.vk_device, renderer.vk_uniformBuffers[i], nullptr);
-        vkFreeMemory(renderer.vk_device, renderer.vk_uniformBuffersMemory[i], nullptr);
+        destroyBuffer(renderer, renderer.vk_uniformBuffers[i], renderer.vk_uniformBuffersAllocation[i]);
     }
 
     vkDestroyDescriptorPool(renderer.vk_device, renderer.vk_descriptorPool, nullptr);
 
     vkDestroyDescriptorSetLayout(renderer.vk_device, renderer.vk_descriptorSetLayout, nullptr);
 
-    vkDestroyBuffer(renderer.vk_device, renderer.vk_indexBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_indexBufferMemory, nullptr);
+    destroyStreamBuffer(renderer);
 
-    vkDestroyBuffer(renderer.vk_device, renderer.vk_vertexBuffer, nullptr);
-    vkFreeMemory(renderer.vk_device, renderer.vk_vertexBufferMemory, nullptr);
+    destroyBuffer(renderer, renderer.vk_meshVertices.buffer, renderer.vk_meshVertices.allocation);
+    destroyBuffer(renderer, renderer.vk_meshIndices16.buffer, renderer.vk_meshIndices16.allocation);
+    destroyBuffer(renderer, renderer.vk_meshIndices32.buffer, renderer.vk_meshIndices32.allocation);
+    renderer.gpuMeshes.clear();
 
     vkDestroyPipeline(renderer.vk_device, renderer.vk_graphicsPipeline, nullptr);
+    vkDestroyPipeline(renderer.vk_device, renderer.vk_doubleSidedPipeline, nullptr);
+    destroyPipelineCache(renderer);
     vkDestroyPipelineLayout(renderer.vk_device, renderer.vk_pipelineLayout, nullptr);
 
     vkDestroyRenderPass(renderer.vk_device, renderer.vk_renderPass, nullptr);
@@ -1548,8 +2160,11 @@ void Renderer::cleanupRenderer(Renderer::Context& renderer) {
         vkDestroyFence(renderer.vk_device, renderer.vk_inFlightFences[i], nullptr);
     }
 
+    destroyRecordingThreads(renderer);
     vkDestroyCommandPool(renderer.vk_device, renderer.vk_commandPool, nullptr);
+    vkDestroyCommandPool(renderer.vk_device, renderer.vk_transferCommandPool, nullptr);
 
+    renderer.vk_memoryAllocator.destroy();
     vkDestroyDevice(renderer.vk_device, nullptr);
 
     if (enableValidationLayers) {
@@ -14,6 +14,8 @@
 #include "glm/glm.hpp"
 
 #include "src/Engine/Entity/Vertex.h"
+#include "GpuMemoryAllocator.h"
+#include "RecordingThreads.h"
 
 const float pi = 3.14159f;
 
@@ -22,6 +24,10 @@ namespace Renderer {
 }
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin"; // relative to the directory the engine is run from, as the shaders are.
+const uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x50435253; // "SRCP"
+const uint64_t NO_SCENE_VERSION = UINT64_MAX; // the version of a cached command buffer that has to be recorded again.
+const VkDeviceSize STREAM_BUFFER_FRAME_SIZE = 1 << 20; // the starting size of each frame's part of the stream buffer, it grows if a frame needs more.
 static uint32_t currentFrame = 0;
 
 struct VertexInputDescription {
@@ -36,12 +42,80 @@ struct VertexInputDescription {
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily; // a family that can transfer but not draw (the copy engine on most discrete gpus), uploads go through the graphics queue without one.
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
 	}
 };
 
+// Copies recorded together and submitted as one command buffer. The batch is polled with uploadBatchFinished or waited on with waitForUploadBatch,
+// either of which frees its buffers and command buffers once the gpu is done with it, so every submitted batch has to be finished by one of the two.
+struct UploadBatch {
+	VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+	VkCommandBuffer acquireCommands = VK_NULL_HANDLE; // runs on the graphics queue after the transfer queue to take ownership of what was written, only with a dedicated transfer queue.
+	VkSemaphore transferFinished = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	std::vector<VkBuffer> buffersToFree; // its staging buffers, and mesh buffers that were replaced by bigger ones while it was recorded (it may already copy into them).
+	std::vector<GpuAllocation> allocationsToFree;
+	bool submitted = false;
+};
+
+// Every mesh's vertices and indices go in a few buffers that are shared by all meshes (see MeshGeometry), so a mesh is where it is in them.
+// It stays on the gpu and is drawn with a transform instead of having its vertices rewritten.
+struct GpuMesh {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	int32_t vertexOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16; // which of the shared index buffers the indices are in.
+};
+
+// One buffer shared by the meshes, it keeps a copy of what it holds so it can be made again, bigger, when a new mesh does not fit.
+struct MeshGeometry {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	GpuAllocation allocation;
+	VkDeviceSize capacity = 0;
+	std::vector<char> data;
+};
+
+// What one indexed draw reads, ending up as a VkDrawIndexedIndirectCommand.
+struct DrawItem {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t firstInstance; // where the draw's instances start in Context::instances.
+	uint32_t instanceCount;
+	VkIndexType indexType;
+	bool flatShade; // lights each triangle by the angle it is seen at, as the cpu path does for streamed vertices.
+	bool doubleSided; // drawn with vk_doubleSidedPipeline, which culls no faces.
+};
+
+// Draw items next to each other (once sorted) that share the pipeline state and buffers, so they are drawn by one vkCmdDrawIndexedIndirect.
+struct DrawBatch {
+	VkIndexType indexType;
+	bool flatShade;
+	bool doubleSided;
+	uint32_t firstCommand;
+	uint32_t commandCount;
+};
+
+// What PIPELINE_CACHE_FILE starts with, followed by the data of vkGetPipelineCacheData. The driver version is not part of vulkan's own header,
+// so this is what tells a cache of an older driver apart.
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t dataSize;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+// matches the push_constant block of shader.vert and shader.frag. The model is applied after the instance's transform, it is the identity for now.
+struct MeshPushConstants {
+	float model[16];
+	int32_t flatShade;
+};
+
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
 	std::vector<VkSurfaceFormatKHR> formats;
@@ -67,6 +141,12 @@ void createSwapChain(Renderer::Context& renderer);
 void createImageViews(Renderer::Context& renderer);
 void createDescriptorSetLayout(Renderer::Context& renderer);
 void createGraphicsPipeline(Renderer::Context& renderer);
+
+// loads the pipeline cache from PIPELINE_CACHE_FILE if it was written for this device and driver, otherwise starts an empty one.
+void createPipelineCache(Renderer::Context& renderer);
+
+// saves the pipeline cache to PIPELINE_CACHE_FILE before destroying it.
+void destroyPipelineCache(Renderer::Context& renderer);
 bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 void createRenderPass(Renderer::Context& renderer);
 void createFramebuffers(Renderer::Context& renderer);
@@ -75,22 +155,54 @@ void createTextureImage(Renderer::Context& renderer);
 void createTextureImageView(Renderer::Context& renderer);
 void createTextureSampler(Renderer::Context& renderer);
 void createDepthResources(Renderer::Context& renderer);
-void createVertexBuffer(Renderer::Context& renderer);
-void createIndexBuffer(Renderer::Context& renderer);
+void createStreamBuffer(Renderer::Context& renderer, VkDeviceSize frameSize);
 void createUniformBuffers(Renderer::Context& renderer);
 void createDescriptorPool(Renderer::Context& renderer);
 void createDescriptorSets(Renderer::Context& renderer);
 void createCommandBuffer(Renderer::Context& renderer);
 void createSyncObjects(Renderer::Context& renderer);
 
-void updateVertexBuffer(Renderer::Context& renderer);
-//void updateIndexBuffer(Renderer::Context& renderer);
+// makes a command pool and a secondary command buffer for every recording thread and frame in flight, and starts the threads.
+void createRecordingThreads(Renderer::Context& renderer, uint32_t threadCount);
+void destroyRecordingThreads(Renderer::Context& renderer);
+
+// makes every cached command buffer be recorded again, for when something they use is made again (such as a buffer that grew).
+void invalidateCommandBuffers(Renderer::Context& renderer);
+
+void destroyStreamBuffer(Renderer::Context& renderer);
 
+// sorts the draw items into batches, and writes this frame's vertices, indices, instances and indirect commands into the current frame's part of the stream buffer.
+void updateStreamBuffer(Renderer::Context& renderer);
 
-void transitionImageLayout(Renderer::Context& renderer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+// records a layout transition of a colour image into the command buffer.
+void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 VkImageView createImageView(Renderer::Context& renderer, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-void createBuffer(Renderer::Context& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-void copyBufferToImage(Renderer::Context& renderer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+void createBuffer(Renderer::Context& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GpuAllocation& bufferAllocation);
+void destroyBuffer(Renderer::Context& renderer, VkBuffer& buffer, GpuAllocation& bufferAllocation);
+void createImage(Renderer::Context& renderer, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GpuAllocation& imageAllocation);
+void destroyImage(Renderer::Context& renderer, VkImage& image, GpuAllocation& imageAllocation);
+
+UploadBatch beginUploadBatch(Renderer::Context& renderer);
+
+// makes a host visible buffer holding a copy of the data, that is freed with the batch.
+VkBuffer createStagingBuffer(Renderer::Context& renderer, UploadBatch& batch, const void* data, VkDeviceSize size);
+
+// records a copy into a buffer that is read by vertex input or shaders once the batch has finished.
+void copyBuffer(Renderer::Context& renderer, UploadBatch& batch, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+// records a copy into the whole of an image whose previous contents are discarded, the image is left ready to be sampled by the fragment shader.
+void copyBufferToImage(Renderer::Context& renderer, UploadBatch& batch, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+
+// submits the batch without waiting for it.
+void submitUploadBatch(Renderer::Context& renderer, UploadBatch& batch);
+
+// returns true (and frees what the batch used) if the gpu has finished the batch.
+bool uploadBatchFinished(Renderer::Context& renderer, UploadBatch& batch);
+void waitForUploadBatch(Renderer::Context& renderer, UploadBatch& batch);
+
+// waits for the batches in vk_pendingUploads, which hold what the next frame draws with.
+void waitForPendingUploads(Renderer::Context& renderer);
 
 // Finds the families that each device is in. This lets us check each devices features.
 QueueFamilyIndices findQueueFamilies(Renderer::Context& renderer, VkPhysicalDevice device);
@@ -118,7 +230,25 @@ namespace Renderer {
 	bool frameClosed(Context& renderer);
 	void cleanupRenderer(Context& renderer);
 	void waitForDeviceIdle(Context& renderer);
-	void updateBuffer(Context& renderer);
+
+	// copies the mesh to buffers on the gpu as part of the batch, returns the index to draw it with.
+	uint32_t addMesh(Context& renderer, UploadBatch& batch, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+	// adds a draw of the mesh to drawItems, the transform is streamed as its instance.
+	// The draw items are drawn after the streamed vertices every frame until drawItems and instances are cleared.
+	// A double sided mesh is drawn without back faces being culled.
+	void drawMesh(Context& renderer, uint32_t mesh, const Mat4& transform, bool flatShade = true, bool doubleSided = false);
+
+	// draws a copy of the mesh for every instance, the instances are copied to Context::instances (with the transform applied to them unless it is the identity).
+	void drawMeshInstanced(Context& renderer, uint32_t mesh, const Mat4& transform, const InstanceData* instances, uint32_t instanceCount, bool flatShade = true, bool doubleSided = false);
+
+	// splits recording the draw items over threadCount threads, each recording a secondary command buffer that the frame's primary one executes.
+	// 1 (the default) records everything into the primary command buffer on the calling thread. Waits for the gpu to be idle.
+	void setRecordThreadCount(Context& renderer, uint32_t threadCount);
+
+	// has to be called whenever the vertices, indices, draw items or instances are changed, frames are only recorded again once the scene version has changed.
+	// The camera (the uniform buffer) can change without it.
+	void markSceneChanged(Context& renderer);
 
 	struct Context {
 		// This context uses vulkan only for now.	
@@ -139,8 +269,12 @@ namespace Renderer {
 		VkDebugUtilsMessengerEXT vk_debugMessenger; // An object that directs all vulkan degugging to a function that directs them to the Seraph Logger.
 		VkPhysicalDevice vk_physicalDevice = VK_NULL_HANDLE; // A struct that stores data on your physical adevice in your hardware that allows us to check the different features and limitations it has.
 		VkDevice vk_device; // Serves as a handle over the physical device just as vk_instance serves over vulkan.
+		GpuMemoryAllocator vk_memoryAllocator; // every buffer and image gets its memory from here.
 		VkQueue vk_graphicsQueue;
 		VkQueue vk_presentQueue;
+		VkQueue vk_transferQueue; // the same as vk_graphicsQueue when the device has no dedicated transfer family.
+		uint32_t vk_graphicsQueueFamily = 0;
+		uint32_t vk_transferQueueFamily = 0;
 		VkSurfaceKHR vk_surface;
 		VkSwapchainKHR vk_swapChain;
 		VkFormat vk_swapChainImageFormat;
@@ -149,15 +283,40 @@ namespace Renderer {
 		VkDescriptorSetLayout vk_descriptorSetLayout;
 		VkPipelineLayout vk_pipelineLayout;
 		VkPipeline vk_graphicsPipeline;
+		VkPipeline vk_doubleSidedPipeline; // the same as vk_graphicsPipeline, but culls no faces. Also draws the streamed vertices, which are culled on the cpu.
+		VkPipelineCache vk_pipelineCache = VK_NULL_HANDLE; // given to every pipeline that is made, and kept on disk between runs.
 		VkCommandPool vk_commandPool;
-		VkBuffer vk_vertexBuffer;
-		VkDeviceMemory vk_vertexBufferMemory;
-		VkBuffer vk_indexBuffer;
-		VkDeviceMemory vk_indexBufferMemory;
+		VkCommandPool vk_transferCommandPool;
+		std::vector<UploadBatch> vk_pendingUploads; // submitted at init and not yet waited on.
+
+		// The vertices and indices are rebuilt every frame, so they are streamed through one buffer that stays mapped and is split into a part per frame in flight.
+		// A part is only written after the in flight fence of its frame has been waited on, so the gpu is never reading what is being written.
+		VkBuffer vk_streamBuffer = VK_NULL_HANDLE;
+		GpuAllocation vk_streamBufferAllocation;
+		char* vk_streamBufferMapped = nullptr;
+		VkDeviceSize vk_streamFrameSize = 0; // the size of one frame's part.
+		VkDeviceSize vk_streamVertexOffset = 0; // where the current frame's vertices start in the buffer.
+		VkDeviceSize vk_streamIndexOffset = 0;
+		uint32_t vk_streamIndexCount = 0; // the number of indices written for the current frame.
+		VkIndexType vk_streamIndexType = VK_INDEX_TYPE_UINT16; // 16 bit whenever the frame has few enough vertices.
+		VkDeviceSize vk_streamInstanceOffset = 0; // an identity instance for the streamed vertices, then Context::instances.
+		VkDeviceSize vk_streamIndirectOffset = 0; // a VkDrawIndexedIndirectCommand for each draw item, in sorted order.
+
+		// A primary command buffer for every frame in flight and swap chain image (indexed by frame * image count + image), each kept with the scene version
+		// it was recorded at. A frame whose scene has not changed since submits its command buffer again without recording it.
 		std::vector<VkCommandBuffer> vk_commandBuffers;
+		std::vector<uint64_t> vk_commandBufferVersions;
+		uint64_t sceneVersion = 0; // see Renderer::markSceneChanged.
+
+		// Only used when there is more than one recording thread. Every thread has its own command pool for each cached command buffer, as a pool can only be used by one thread,
+		// and the pool is reset as a whole when its command buffer is recorded. Both are indexed by (frame * image count + image) * thread count + thread.
+		RecordingThreads* recordingThreads = nullptr;
+		std::vector<VkCommandPool> vk_recordCommandPools;
+		std::vector<VkCommandBuffer> vk_secondaryCommandBuffers;
+		double lastRecordMilliseconds = 0; // how long recordCommandBuffer took for the last frame, 0 if its command buffer was cached.
 
 		std::vector<VkBuffer> vk_uniformBuffers;
-		std::vector<VkDeviceMemory> vk_uniformBuffersMemory;
+		std::vector<GpuAllocation> vk_uniformBuffersAllocation;
 		std::vector<void*> vk_uniformBuffersMapped;
 		VkDescriptorPool vk_descriptorPool;
 		std::vector<VkDescriptorSet> vk_descriptorSets;
@@ -173,16 +332,28 @@ namespace Renderer {
 		VkImage vk_textureImage;
 		VkImageView vk_textureImageView;
 		VkSampler vk_textureSampler;
-		VkDeviceMemory vk_textureImageMemory;
+		GpuAllocation vk_textureImageAllocation;
 
 		VkImage vk_depthImage;
-		VkDeviceMemory vk_depthImageMemory;
+		GpuAllocation vk_depthImageAllocation;
 		VkImageView vk_depthImageView;
 
 		bool vk_framebufferResized = false;
 
 		std::vector<Vertex> vertices;
-		std::vector<uint16_t> indices;
+		std::vector<uint32_t> indices;
+
+		std::vector<GpuMesh> gpuMeshes;
+		MeshGeometry vk_meshVertices;
+		MeshGeometry vk_meshIndices16;
+		MeshGeometry vk_meshIndices32;
+
+		std::vector<DrawItem> drawItems; // sorted by updateStreamBuffer, so the order they were added in is not kept.
+		std::vector<InstanceData> instances; // cleared together with drawItems.
+		std::vector<DrawBatch> drawBatches; // the current frame's, made by updateStreamBuffer.
+
+		bool vk_multiDrawIndirect = false; // without it every indirect command is drawn by its own call.
+		bool vk_drawIndirectFirstInstance = false; // without it indirect commands cannot start past the first instance, so draw items are drawn directly.
 
 		struct UniformBufferObject {
 			glm::mat4 proj;
@@ -1,9 +1,23 @@
 #version 450
 
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    int flatShade;
+} push;
+
 layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec3 viewPosition;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = fragColor;
+    if (push.flatShade != 0) {
+        // the triangle's normal from how the position changes across it, lit by the angle it is seen at like the cpu path.
+        vec3 normal = normalize(cross(dFdx(viewPosition), dFdy(viewPosition)));
+        float brightness = asin(abs(dot(normal, normalize(viewPosition)))) / (3.14159f / 2.0f);
+        outColor = vec4(fragColor.rgb * brightness, fragColor.a);
+    }
+    else {
+        outColor = fragColor;
+    }
 }
\ No newline at end of file
@@ -5,22 +5,31 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+// the transform of the mesh being drawn (identity for the streamed vertices), the same block is in shader.frag.
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    int flatShade;
+} push;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec4 inColor;
 
+// the instance's transform by rows and its colour, see InstanceData.
+layout(location = 2) in vec4 instanceRow0;
+layout(location = 3) in vec4 instanceRow1;
+layout(location = 4) in vec4 instanceRow2;
+layout(location = 5) in vec4 instanceRow3;
+layout(location = 6) in vec4 instanceColor;
+
 layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec3 viewPosition;
 
 void main() {
-    gl_Position = vec4(inPosition, 1.0f) * ubo.proj;
-
-    if (gl_Position[3] != 0) {
-        gl_Position[0] = gl_Position[0] / gl_Position[3];
-        gl_Position[1] = gl_Position[1] / gl_Position[3];
-        gl_Position[2] = gl_Position[2] / gl_Position[3];
-        gl_Position[3] = gl_Position[3] / gl_Position[3];
-    }
+    mat4 instanceModel = mat4(instanceRow0, instanceRow1, instanceRow2, instanceRow3);
+    viewPosition = (vec4(inPosition, 1.0f) * instanceModel * push.model).xyz;
+    gl_Position = vec4(viewPosition, 1.0f) * ubo.proj; // the divide by w is left to the gpu, which also clips what is behind the camera.
 
     float temp = (gl_Position[0]*0 + gl_Position[1]*0 + gl_Position[2]*1) / (gl_Position[0]*gl_Position[0] + gl_Position[1]*gl_Position[1] + gl_Position[2]*gl_Position[2]);
 
-    fragColor = inColor;
+    fragColor = inColor * instanceColor;
 }
\ No newline at end of file
@@ -0,0 +1,477 @@
+#include "GpuMemoryAllocator.h"
+#include "Renderer.h"
+#include "_TEST_Renderer.h"
+#include "CommonIncludes.h"
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// The tests make their own instance and device without a window or surface, so they also run on a cpu implementation of vulkan
+// such as lavapipe (point VK_ICD_FILENAMES at lvp_icd.x86_64.json to force it).
+struct TestDevice {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+};
+
+static bool createTestDevice(TestDevice& testDevice) {
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Seraph Renderer Tests";
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    if (vkCreateInstance(&createInfo, nullptr, &testDevice.instance) != VK_SUCCESS) {
+        return false;
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(testDevice.instance, &deviceCount, nullptr);
+    if (0 == deviceCount) {
+        vkDestroyInstance(testDevice.instance, nullptr);
+        return false;
+    }
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(testDevice.instance, &deviceCount, devices.data());
+    testDevice.physicalDevice = devices[0];
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(testDevice.physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(testDevice.physicalDevice, &queueFamilyCount, queueFamilies.data());
+    for (uint32_t i = 0; i < queueFamilyCount; i++) {
+        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            testDevice.queueFamily = i;
+            break;
+        }
+    }
+
+    float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo{};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = testDevice.queueFamily;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueCreateInfo;
+
+    if (vkCreateDevice(testDevice.physicalDevice, &deviceInfo, nullptr, &testDevice.device) != VK_SUCCESS) {
+        vkDestroyInstance(testDevice.instance, nullptr);
+        return false;
+    }
+    vkGetDeviceQueue(testDevice.device, testDevice.queueFamily, 0, &testDevice.queue);
+    return true;
+}
+
+static void destroyTestDevice(TestDevice& testDevice) {
+    vkDestroyDevice(testDevice.device, nullptr);
+    vkDestroyInstance(testDevice.instance, nullptr);
+}
+
+struct TestBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    GpuAllocation allocation;
+    VkDeviceSize alignment = 0;
+    unsigned char pattern = 0;
+};
+
+// Allocates buffers of random sizes in small blocks, checks that they are aligned and never overlap, that host visible memory keeps what is written to it,
+// and that the stats add up, then frees half, refills the gaps and frees everything.
+int testGpuMemoryAllocator() {
+
+    TestDevice testDevice;
+    if (!createTestDevice(testDevice)) {
+        logRecord("No vulkan device was found, the gpu memory allocator test was skipped.", logLevelWarning);
+        return 0;
+    }
+
+    int failures = 0;
+    const int bufferCount = 2000;
+
+    GpuMemoryAllocator allocator;
+    allocator.init(testDevice.physicalDevice, testDevice.device, 1 << 20); // small blocks, so the test fills several of them.
+
+    std::mt19937 random(7);
+    std::vector<TestBuffer> buffers(bufferCount);
+
+    auto allocateBuffer = [&](TestBuffer& someBuffer, int index) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = 16 + random() % (64 << 10);
+        bufferInfo.usage = index % 3 ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &someBuffer.buffer);
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(testDevice.device, someBuffer.buffer, &requirements);
+        someBuffer.alignment = requirements.alignment;
+
+        VkMemoryPropertyFlags properties = index % 2 ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if (!allocator.allocate(requirements, properties, true, someBuffer.allocation)) {
+            logRecord("Failed to allocate buffer " + std::to_string(index) + " of " + std::to_string(requirements.size) + " bytes.", logLevelError);
+            failures++;
+            return;
+        }
+        vkBindBufferMemory(testDevice.device, someBuffer.buffer, someBuffer.allocation.memory, someBuffer.allocation.offset);
+
+        someBuffer.pattern = (unsigned char)(index * 31 + 1);
+        if (nullptr != someBuffer.allocation.mapped) {
+            memset(someBuffer.allocation.mapped, someBuffer.pattern, (size_t)someBuffer.allocation.size);
+        }
+    };
+
+    auto checkBuffers = [&](const char* stage) {
+        std::vector<TestBuffer*> live;
+        VkDeviceSize usedBytes = 0;
+        for (TestBuffer& someBuffer : buffers) {
+            if (VK_NULL_HANDLE == someBuffer.allocation.memory) {
+                continue;
+            }
+            live.push_back(&someBuffer);
+            usedBytes += someBuffer.allocation.size;
+
+            if (0 != someBuffer.allocation.offset % someBuffer.alignment) {
+                logRecord(std::string(stage) + ": an allocation is not aligned to " + std::to_string(someBuffer.alignment), logLevelError);
+                failures++;
+            }
+            if (nullptr != someBuffer.allocation.mapped) {
+                unsigned char* bytes = (unsigned char*)someBuffer.allocation.mapped;
+                if (bytes[0] != someBuffer.pattern || bytes[someBuffer.allocation.size - 1] != someBuffer.pattern) {
+                    logRecord(std::string(stage) + ": host visible memory was overwritten by another allocation.", logLevelError);
+                    failures++;
+                }
+            }
+        }
+
+        std::sort(live.begin(), live.end(), [](TestBuffer* lhs, TestBuffer* rhs) {
+            return lhs->allocation.memory != rhs->allocation.memory ? lhs->allocation.memory < rhs->allocation.memory : lhs->allocation.offset < rhs->allocation.offset;
+        });
+        for (size_t index = 1; index < live.size(); index++) {
+            GpuAllocation& previous = live[index - 1]->allocation;
+            GpuAllocation& current = live[index]->allocation;
+            if (previous.memory == current.memory && previous.offset + previous.size > current.offset) {
+                logRecord(std::string(stage) + ": two allocations overlap.", logLevelError);
+                failures++;
+                break;
+            }
+        }
+
+        GpuMemoryStats stats = allocator.getStats();
+        if (stats.allocationCount != live.size() || stats.usedBytes != usedBytes || stats.usedBytes > stats.reservedBytes) {
+            logRecord(std::string(stage) + ": the stats do not match the live allocations.", logLevelError);
+            failures++;
+        }
+        logRecord(std::string(stage) + ": " + std::to_string(stats.allocationCount) + " allocations in " + std::to_string(stats.blockCount) + " blocks, "
+            + std::to_string(stats.usedBytes) + " of " + std::to_string(stats.reservedBytes) + " bytes used, " + std::to_string(stats.deviceAllocationCalls) + " vkAllocateMemory calls.", logLevelInfo);
+    };
+
+    for (int index = 0; index < bufferCount; index++) {
+        allocateBuffer(buffers[index], index);
+    }
+    checkBuffers("Filled");
+
+    // every other buffer of each memory type (the type alternates with the index), so the blocks are left full of holes.
+    for (int index = 0; index < bufferCount; index += 4) {
+        for (int pair = 0; pair < 2; pair++) {
+            vkDestroyBuffer(testDevice.device, buffers[index + pair].buffer, nullptr);
+            allocator.free(buffers[index + pair].allocation);
+        }
+    }
+    checkBuffers("Half freed");
+
+    for (int index = 0; index < bufferCount; index += 4) {
+        for (int pair = 0; pair < 2; pair++) {
+            allocateBuffer(buffers[index + pair], index + pair);
+        }
+    }
+    checkBuffers("Refilled");
+
+    if (allocator.getStats().deviceAllocationCalls * 10 > (unsigned long long)bufferCount) {
+        logRecord("Buffers are not sharing blocks, vkAllocateMemory was called " + std::to_string(allocator.getStats().deviceAllocationCalls) + " times.", logLevelError);
+        failures++;
+    }
+
+    // an optimal tiling image goes in a block of its own kind, apart from the buffers.
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { 256, 256, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkImage image;
+    GpuAllocation imageAllocation;
+    vkCreateImage(testDevice.device, &imageInfo, nullptr, &image);
+    VkMemoryRequirements imageRequirements;
+    vkGetImageMemoryRequirements(testDevice.device, image, &imageRequirements);
+    if (!allocator.allocate(imageRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, imageAllocation) || 0 != imageAllocation.offset % imageRequirements.alignment) {
+        logRecord("Failed to allocate an aligned image.", logLevelError);
+        failures++;
+    } else {
+        for (TestBuffer& someBuffer : buffers) {
+            if (someBuffer.allocation.memory == imageAllocation.memory) {
+                logRecord("An image was placed in the same block as a buffer.", logLevelError);
+                failures++;
+                break;
+            }
+        }
+        vkBindImageMemory(testDevice.device, image, imageAllocation.memory, imageAllocation.offset);
+    }
+    vkDestroyImage(testDevice.device, image, nullptr);
+    allocator.free(imageAllocation);
+
+    for (TestBuffer& someBuffer : buffers) {
+        vkDestroyBuffer(testDevice.device, someBuffer.buffer, nullptr);
+        allocator.free(someBuffer.allocation);
+    }
+    GpuMemoryStats stats = allocator.getStats();
+    if (0 != stats.allocationCount || 0 != stats.usedBytes) {
+        logRecord("Allocations are still counted after everything was freed.", logLevelError);
+        failures++;
+    }
+    logRecord("After freeing everything " + std::to_string(stats.blockCount) + " blocks are kept (one per pool that was used).", logLevelInfo);
+
+    allocator.destroy();
+    destroyTestDevice(testDevice);
+
+    logRecord("Gpu memory allocator test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+    return failures;
+}
+
+// draws the frames and returns the average milliseconds a frame took, addDraws is timed on its own as the cpu cost of giving the renderer the draws.
+// The average time recordCommandBuffer took is put in recordMilliseconds if it is given.
+template<typename AddDraws>
+static double timeFrames(Renderer::Context& renderer, int frameCount, AddDraws addDraws, double& addDrawsMilliseconds, double* recordMilliseconds = nullptr) {
+    addDrawsMilliseconds = 0;
+    double recordTotal = 0;
+    auto start = std::chrono::steady_clock::now();
+    int framesDrawn = 0;
+    for (; framesDrawn < frameCount && !Renderer::frameClosed(renderer); framesDrawn++) {
+        glfwPollEvents();
+
+        auto drawsStart = std::chrono::steady_clock::now();
+        renderer.drawItems.clear();
+        renderer.instances.clear();
+        addDraws();
+        Renderer::markSceneChanged(renderer);
+        addDrawsMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drawsStart).count();
+
+        Renderer::runFrame(renderer);
+        recordTotal += renderer.lastRecordMilliseconds;
+    }
+    Renderer::waitForDeviceIdle(renderer);
+    double totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (0 == framesDrawn) {
+        return 0;
+    }
+    addDrawsMilliseconds /= framesDrawn;
+    if (nullptr != recordMilliseconds) {
+        *recordMilliseconds = recordTotal / framesDrawn;
+    }
+    return totalMilliseconds / framesDrawn;
+}
+
+// adds a unit cube, in front of the camera when it is not moved, to the batch and returns its mesh.
+static uint32_t addTestCube(Renderer::Context& renderer, UploadBatch& batch) {
+    std::vector<Vertex> cubeVertices;
+    for (int corner = 0; corner < 8; corner++) {
+        cubeVertices.push_back({ { corner & 4 ? -0.5f : 0.5f, corner & 2 ? -0.5f : 0.5f, corner & 1 ? 1.0f : 2.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+    }
+    std::vector<uint32_t> cubeIndices = { 0, 1, 3, 0, 3, 2, 0, 2, 6, 0, 6, 4, 2, 3, 7, 6, 2, 7, 6, 7, 5, 4, 6, 5, 3, 1, 5, 3, 5, 7, 1, 0, 4, 1, 4, 5 };
+
+    return Renderer::addMesh(renderer, batch, cubeVertices.data(), (uint32_t)cubeVertices.size(), cubeIndices.data(), (uint32_t)cubeIndices.size());
+}
+
+// adds the cube in a batch of its own.
+static uint32_t addTestCube(Renderer::Context& renderer) {
+    UploadBatch batch = beginUploadBatch(renderer);
+    uint32_t cube = addTestCube(renderer, batch);
+    submitUploadBatch(renderer, batch);
+    renderer.vk_pendingUploads.push_back(batch);
+    return cube;
+}
+
+int testMeshGrowth(Renderer::Context& renderer) {
+    int failures = 0;
+
+    UploadBatch batch = beginUploadBatch(renderer);
+
+    uint32_t cube = addTestCube(renderer, batch);
+
+    // the cube is copied into this buffer by the batch, the next mesh is one vertex more than is left in it.
+    MeshGeometry& geometry = renderer.vk_meshVertices;
+    VkBuffer cubeBuffer = geometry.buffer;
+    size_t copiedBuffers = batch.buffersToFree.size();
+    uint32_t stripVertexCount = std::max(3u, (uint32_t)((geometry.capacity - geometry.data.size()) / sizeof(Vertex)) + 1);
+
+    // a strip of thin triangles along the x axis, behind the cube.
+    std::vector<Vertex> stripVertices(stripVertexCount);
+    for (uint32_t index = 0; index < stripVertexCount; index++) {
+        float x = (float)(index / 2) / (stripVertexCount / 2) * 4.0f - 2.0f;
+        stripVertices[index] = { { x, index % 2 ? -1.0f : 1.0f, 4.0f }, { 0.5f, 0.5f, 1.0f, 1.0f } };
+    }
+    std::vector<uint32_t> stripIndices;
+    for (uint32_t index = 2; index < stripVertexCount; index++) {
+        stripIndices.insert(stripIndices.end(), { index - 2, index - 1, index });
+    }
+    uint32_t strip = Renderer::addMesh(renderer, batch, stripVertices.data(), stripVertexCount, stripIndices.data(), (uint32_t)stripIndices.size());
+
+    if (geometry.buffer == cubeBuffer || geometry.capacity < geometry.data.size()) {
+        logRecord("The shared vertex buffer did not grow to fit the second mesh.", logLevelError);
+        failures++;
+    }
+    if (std::find(batch.buffersToFree.begin() + copiedBuffers, batch.buffersToFree.end(), cubeBuffer) == batch.buffersToFree.end()) {
+        logRecord("The vertex buffer the batch copies the cube into is not kept until the batch has finished.", logLevelError);
+        failures++;
+    }
+
+    submitUploadBatch(renderer, batch);
+    waitForUploadBatch(renderer, batch);
+    if (!batch.buffersToFree.empty()) {
+        logRecord("The batch still holds buffers after it has finished.", logLevelError);
+        failures++;
+    }
+
+    std::vector<Vertex> savedVertices = renderer.vertices;
+    std::vector<uint32_t> savedIndices = renderer.indices;
+    renderer.vertices.clear();
+    renderer.indices.clear();
+
+    double addMilliseconds;
+    timeFrames(renderer, 10, [&]() {
+        Renderer::drawMesh(renderer, cube, Mat4());
+        Renderer::drawMesh(renderer, strip, Mat4());
+    }, addMilliseconds);
+
+    renderer.drawItems.clear();
+    renderer.instances.clear();
+    renderer.vertices = savedVertices;
+    renderer.indices = savedIndices;
+    Renderer::markSceneChanged(renderer);
+
+    logRecord("Mesh growth test finished with " + std::to_string(failures) + " failures.", failures ? logLevelError : logLevelInfo);
+    return failures;
+}
+
+int benchmarkInstancing(Renderer::Context& renderer) {
+    const int frameCount = 200;
+
+    uint32_t cube = addTestCube(renderer);
+
+    std::vector<Vertex> savedVertices = renderer.vertices;
+    std::vector<uint32_t> savedIndices = renderer.indices;
+    renderer.vertices.clear();
+    renderer.indices.clear();
+
+    const Mat4 identity;
+
+    for (int instanceCount : { 10000, 100000 }) {
+        // a square grid of cubes, getting further away from the camera.
+        int side = (int)ceil(sqrt((double)instanceCount));
+        std::vector<InstanceData> cubes(instanceCount);
+        for (int index = 0; index < instanceCount; index++) {
+            int column = index % side;
+            int row = index / side;
+            cubes[index].transform = Mat4::translation((column - side / 2) * 1.5f, 5.0f, 10.0f + row * 1.5f);
+            cubes[index].color[0] = (float)column / side;
+            cubes[index].color[1] = (float)row / side;
+            cubes[index].color[2] = 1.0f;
+        }
+
+        double addMilliseconds;
+        double frameMilliseconds = timeFrames(renderer, frameCount, [&]() {
+            Renderer::drawMeshInstanced(renderer, cube, identity, cubes.data(), (uint32_t)cubes.size());
+        }, addMilliseconds);
+
+        logRecord(std::to_string(instanceCount) + " instances in one draw: " + std::to_string(frameMilliseconds) + "ms a frame, "
+            + std::to_string(addMilliseconds) + "ms of it adding the instances.", logLevelInfo);
+
+        if (10000 == instanceCount) {
+            // the same cubes drawn one draw call each.
+            frameMilliseconds = timeFrames(renderer, frameCount, [&]() {
+                for (InstanceData& someCube : cubes) {
+                    Renderer::drawMesh(renderer, cube, someCube.transform);
+                }
+            }, addMilliseconds);
+
+            logRecord(std::to_string(instanceCount) + " cubes drawn separately: " + std::to_string(frameMilliseconds) + "ms a frame, "
+                + std::to_string(addMilliseconds) + "ms of it adding the draws.", logLevelInfo);
+        }
+    }
+
+    renderer.drawItems.clear();
+    renderer.instances.clear();
+    renderer.vertices = savedVertices;
+    renderer.indices = savedIndices;
+    Renderer::markSceneChanged(renderer);
+
+    return 0;
+}
+
+int benchmarkRecordingThreads(Renderer::Context& renderer) {
+    const int frameCount = 200;
+    const int cubeCount = 20000;
+
+    uint32_t cube = addTestCube(renderer);
+
+    std::vector<Vertex> savedVertices = renderer.vertices;
+    std::vector<uint32_t> savedIndices = renderer.indices;
+    renderer.vertices.clear();
+    renderer.indices.clear();
+
+    std::vector<Mat4> transforms(cubeCount);
+    int side = (int)ceil(sqrt((double)cubeCount));
+    for (int index = 0; index < cubeCount; index++) {
+        transforms[index] = Mat4::translation((index % side - side / 2) * 1.5f, 5.0f, 10.0f + index / side * 1.5f);
+    }
+
+    // with indirect draws a batch is one call whatever its size, so the draw items are drawn directly to give the threads something to split.
+    bool savedDrawIndirectFirstInstance = renderer.vk_drawIndirectFirstInstance;
+    renderer.vk_drawIndirectFirstInstance = false;
+
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+        Renderer::setRecordThreadCount(renderer, threadCount);
+
+        double addMilliseconds;
+        double recordMilliseconds;
+        double frameMilliseconds = timeFrames(renderer, frameCount, [&]() {
+            for (int index = 0; index < cubeCount; index++) {
+                Renderer::drawMesh(renderer, cube, transforms[index], 0 == index % 2); // two batches, so the threads also have to split across batches.
+            }
+        }, addMilliseconds, &recordMilliseconds);
+
+        logRecord(std::to_string(threadCount) + " recording threads, " + std::to_string(cubeCount) + " draws: " + std::to_string(recordMilliseconds) + "ms recording a frame, "
+            + std::to_string(frameMilliseconds) + "ms a frame.", logLevelInfo);
+    }
+
+    Renderer::setRecordThreadCount(renderer, 1);
+    renderer.vk_drawIndirectFirstInstance = savedDrawIndirectFirstInstance;
+
+    renderer.drawItems.clear();
+    renderer.instances.clear();
+    renderer.vertices = savedVertices;
+    renderer.indices = savedIndices;
+    Renderer::markSceneChanged(renderer);
+
+    return 0;
+}
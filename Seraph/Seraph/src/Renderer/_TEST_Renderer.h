@@ -0,0 +1,18 @@
+#pragma once
+
+namespace Renderer {
+	struct Context;
+}
+
+int testGpuMemoryAllocator();
+
+// adds two meshes in one upload batch, the second too big for the shared vertex buffer so it grows while the batch already copies into it,
+// then draws them. Needs an initialised renderer, run it with the validation layers to catch the old buffer being freed too early.
+int testMeshGrowth(Renderer::Context& renderer);
+
+// draws 10k and then 100k instances of a cube, and 10k cubes as separate draws to compare against. Needs an initialised renderer (it opens a window).
+int benchmarkInstancing(Renderer::Context& renderer);
+
+// draws 20k cubes as separate draws while recording with 1, 2, 4 ... threads (up to the number of cores), and logs how long recording took.
+// Set VK_ICD_FILENAMES to lvp_icd.x86_64.json to measure it on lavapipe, where recording is not hidden behind a fast gpu.
+int benchmarkRecordingThreads(Renderer::Context& renderer);
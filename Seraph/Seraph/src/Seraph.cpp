@@ -7,28 +7,78 @@
 #include <chrono>
 
 #include "Engine/Entity/World.h"
+#include "Engine/Clipping/FrustumClipper.h"
+#include "Engine/Clipping/_TEST_Clipping.h"
+#include "Renderer/_TEST_Renderer.h"
+#include "Engine/MemoryArena/_TEST_MemArena.h"
+
+// define to log the cpu time of every Renderer::runFrame call with the Timer.
+//#define SERAPH_TIME_FRAMES
+
+// define to transform, clip and light the teapot and floor on the cpu every frame and stream them to the gpu, instead of drawing the meshes kept on the gpu with a transform.
+//#define SERAPH_CPU_TRANSFORM
+
+// define to run the instancing benchmark (see Renderer/_TEST_Renderer.h) after the engine is initialised.
+//#define SERAPH_INSTANCE_BENCHMARK
+//#define SERAPH_RECORDING_BENCHMARK
+
+// define to run the renderer tests that need an initialised renderer (see Renderer/_TEST_Renderer.h) after the engine is initialised.
+//#define SERAPH_RENDERER_TESTS
+
+// define to run the memory arena tests (see Engine/MemoryArena/_TEST_MemArena.h) before the engine starts. Build once with SERAPH_MEMORY_ARENA_WIDTH 64 as well,
+// testArenaGrowth only grows an arena past 4 gb with 64 bit sizes (with 32 bit sizes it checks that growing past 4 gb is refused).
+//#define SERAPH_ARENA_TESTS
+
+// define to run the frustum clipper test and benchmark (see Engine/Clipping/_TEST_Clipping.h) before the engine starts.
+//#define SERAPH_CLIP_BENCHMARK
 
 int initEngine();
 int runEngine();
 
-void clipVertices(std::vector<Vertex>& verts, std::vector<uint16_t>& indices, float scaleLeft, bool compareLessThan, float scaleRight, bool xUsed, bool flip);
-
 int main() {
 
 	Timer(program, "Seraph Game engine");
 	logRecord("Seraph Engine has started");
 
+#ifdef SERAPH_ARENA_TESTS
+	benchmarkBlockLookup();
+	testArenaGrowth();
+	testFrameArena();
+	testArenaCompaction();
+	testArenaStatsAndTrace();
+#endif
+
+#ifdef SERAPH_CLIP_BENCHMARK
+	testFrustumClipper();
+	benchmarkFrustumClipper();
+#endif
+
 	int state = initEngine();
 
 	if (state) {
 		throwError("Seraph Engine Initialisization Failed\n", logLevelCritical);
 	}
 
+#ifdef SERAPH_RENDERER_TESTS
+	testGpuMemoryAllocator();
+	testMeshGrowth(seraph.rendererContext);
+#endif
+#ifdef SERAPH_INSTANCE_BENCHMARK
+	benchmarkInstancing(seraph.rendererContext);
+#endif
+#ifdef SERAPH_RECORDING_BENCHMARK
+	benchmarkRecordingThreads(seraph.rendererContext);
+#endif
+
 	state = runEngine();
 
 	if (state) {
 		throwError("Failed to run Seraph Engine.\n", logLevelCritical);
 	}
+
+	// cleaned up here rather than by seraph's destructor, which runs after main returns when the vulkan driver may already be unloaded,
+	// and the pipeline cache is saved while cleaning up.
+	Renderer::cleanupRenderer(seraph.rendererContext);
 }
 
 int initEngine() {
@@ -55,25 +105,58 @@ int initEngine() {
 	seraph.rendererContext.indices = { 0, 1, 3, 0, 3, 2, 0, 2, 6, 0, 6, 4, 2, 3, 7, 6, 2, 7, 6, 7, 5, 4, 6, 5, 3, 1, 5, 3, 5, 7, 1, 0, 4, 1, 4, 5 };
 
 	Renderer::initRenderer(seraph.rendererContext);
-
-	int sizeOfPlayer = sizeof(Player);
-	int sizeOfPPball = sizeof(Ball);
-	int spaceRequiredInBytes = sizeOfPlayer * 2 + sizeOfPPball;
-	seraph.memoryArena = MemoryArena(spaceRequiredInBytes);
 	return 0;
 }
 
-int runEngine() {
+// Puts the objects the camera can see in the renderer's vertices and indices, with their back faces culled and their triangles clipped to the planes.
+// Each object is first tested whole: one outside of a plane is left out, one inside of every plane is added as it is, and only the triangles of the
+// ones crossing a plane go through clipTriangles. The back faces go before the clipping, so it never works on them.
+static void streamVisibleObjects(Renderer::Context& renderer, GameObject* const* objects, int objectCount, const ClipPlane* planes, int planeCount, FrameArena& frameArena, ClipStats& stats) {
+	renderer.vertices.clear();
+	renderer.indices.clear();
+
+	FrameVector<BoundsClip> objectClips(objectCount, boundsOutside, FrameAllocator<BoundsClip>(frameArena));
+
+	uint32_t culledObjects = 0;
+	uint32_t insideObjects = 0;
+	uint32_t backFaceTriangles = 0;
+	for (int object = 0; object < objectCount; object++) {
+		const Mesh& mesh = *objects[object]->mesh;
+		objectClips[object] = classifyBounds(mesh.m_boundsMin, mesh.m_boundsMax, mesh.m_boundsCenter, mesh.m_boundsRadius, objects[object]->m_transform, planes, planeCount);
+		if (boundsCrossing == objectClips[object]) {
+			size_t firstIndex = renderer.indices.size();
+			objects[object]->addToBuffer(renderer.vertices, renderer.indices);
+			if (!mesh.m_doubleSided) {
+				backFaceTriangles += cullBackFaces(renderer.vertices, renderer.indices, firstIndex);
+			}
+		}
+		culledObjects += boundsOutside == objectClips[object];
+		insideObjects += boundsInside == objectClips[object];
+	}
 
-	Timer(engineRun, "Seraph Engine Running");
+	// the crossing objects are clipped before the inside ones are added, so clipTriangles never looks at the triangles that do not need it.
+	stats = ClipStats();
+	if (!renderer.indices.empty()) {
+		clipTriangles(renderer.vertices, renderer.indices, planes, planeCount, frameArena, &stats);
+	}
+	stats.culledObjects = culledObjects;
+	stats.unclippedObjects = insideObjects;
 
-	DataBlockCodeType p1_Code = seraph.memoryArena.allocateData(sizeof(Player));
-	DataBlockCodeType p2_Code = seraph.memoryArena.allocateData(sizeof(Player));
-	DataBlockCodeType ppBall_Code = seraph.memoryArena.allocateData(sizeof(Ball));
+	for (int object = 0; object < objectCount; object++) {
+		if (boundsInside == objectClips[object]) {
+			size_t firstIndex = renderer.indices.size();
+			objects[object]->addToBuffer(renderer.vertices, renderer.indices);
+			if (!objects[object]->mesh->m_doubleSided) {
+				backFaceTriangles += cullBackFaces(renderer.vertices, renderer.indices, firstIndex);
+			}
+		}
+	}
+	stats.backFaceTriangles = backFaceTriangles;
+}
+
+int runEngine() {
 
-	Player* p1 = (Player*)seraph.memoryArena.getDataAddress(p1_Code);
-	Player* p2 = (Player*)seraph.memoryArena.getDataAddress(p2_Code);
-	Ball* ppBall = (Ball*)seraph.memoryArena.getDataAddress(ppBall_Code);
+	Timer(engineRun, "Seraph Engine Running");
 
 	// get initial data
 	short xBuffer = screenWidth - wallBufferWidth;
@@ -83,10 +166,10 @@ int runEngine() {
 	Location p2Pos = Location(xBuffer, wallBufferHeight);
 	PlayerSize p1Size = PlayerSize(p1_puckWidth, p1_puckLength);
 	PlayerSize p2Size = PlayerSize(p2_puckWidth, p2_puckLength);
-	*p1 = Player(p1_Health, state, p1Pos, p1Size);
-	*p2 = Player(p2_Health, state, p2Pos, p2Size);
+	Player* p1 = seraph.players.acquire(p1_Health, state, p1Pos, p1Size);
+	Player* p2 = seraph.players.acquire(p2_Health, state, p2Pos, p2Size);
 	Location ppballPos = Location(0, 0);
-	*ppBall = Ball(PingPongBall_Radius, ppballPos);
+	Ball* ppBall = seraph.balls.acquire(PingPongBall_Radius, ppballPos);
 
 	// set world data
 	seraph.rendererContext.vertices.clear();
@@ -96,7 +179,6 @@ int runEngine() {
 	GameObject teapot;
 	teapot.mesh = &teapotMesh;
 	teapotMesh.loadMesh("src/teapot.txt");
-	teapot.addToBufferNoIndex(seraph.rendererContext.vertices, seraph.rendererContext.indices);
 	//Renderer::updateBuffer(seraph.rendererContext);
 
 	//seraph.rendererContext.vertices.clear();
@@ -106,43 +188,49 @@ int runEngine() {
 	floor.mesh = &floorMesh;
 	floorMesh.m_vertexCount = 121; // 10 by 10 grid needs 11 by 11 points
 	floorMesh.m_vertexData = new Vertex[floorMesh.m_vertexCount];
-	floorMesh.m_indicesCount = 100*2*3 * 2;
-	floorMesh.m_indices = new uint16_t[floorMesh.m_indicesCount];
+	floorMesh.m_indicesCount = 100*2*3;
+	floorMesh.m_indices = new uint32_t[floorMesh.m_indicesCount];
+	floorMesh.m_doubleSided = true; // seen from above and below, so it is drawn without its back faces being culled.
 
 	for (int i = 0; i < 11; i++) {
 		for (int k = 0; k < 11; k++) {
 			floorMesh.m_vertexData[i*11+k] = Vertex({ {  (i - 5.5f)*10,  10, (k - 5.5f) *10}, {1.0f, 1.0f, 1.0f, 1.0f} });
 		}
 	}
+	floorMesh.updateBounds();
 	//seraph.rendererContext.vertices = { { {0,  1.0f},   {0.5f, 0.0f, 0.0f, 0.5f} },
 	//								    { {0.5f, -0.5f},  {0.0f, 0.5f, 0.0f, 0.5f} },
 	// 							        { {-0.5f, -0.5f}, {0.0f, 0.0f, 0.5f, 0.5f} } };
 
-	std::vector<uint16_t> floorIndexData;
+	std::vector<uint32_t> floorIndexData;
 
 	for (int i = 0; i < 11; i++) {
 		for (int k = 0; k < 11; k++) {
 			if (k != 10 && i != 10) {
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k)] = i * 11 + k;
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 1] = i * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 2] = (i + 1) * 11 + k;
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 3] = i * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 4] = (i + 1) * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 5] = (i + 1) * 11 + k;
-
-				// same points just anit clockise for reverse viewing.
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 6] = i * 11 + k;
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 2 + 6] = i * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 1 + 6] = (i + 1) * 11 + k;
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 3 + 6] = i * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 5 + 6] = (i + 1) * 11 + (k + 1);
-				floorMesh.m_indices[2 * 2 * 3 * (i * 10 + k) + 4 + 6] = (i + 1) * 11 + k;
+				floorMesh.m_indices[2 * 3 * (i * 10 + k)] = i * 11 + k;
+				floorMesh.m_indices[2 * 3 * (i * 10 + k) + 1] = i * 11 + (k + 1);
+				floorMesh.m_indices[2 * 3 * (i * 10 + k) + 2] = (i + 1) * 11 + k;
+				floorMesh.m_indices[2 * 3 * (i * 10 + k) + 3] = i * 11 + (k + 1);
+				floorMesh.m_indices[2 * 3 * (i * 10 + k) + 4] = (i + 1) * 11 + (k + 1);
+				floorMesh.m_indices[2 * 3 * (i * 10 + k) + 5] = (i + 1) * 11 + k;
 			}
 		}
 	}
 
+#ifdef SERAPH_CPU_TRANSFORM
+	teapot.addToBuffer(seraph.rendererContext.vertices, seraph.rendererContext.indices);
 	floor.addToBuffer(seraph.rendererContext.vertices, seraph.rendererContext.indices);
-	Renderer::updateBuffer(seraph.rendererContext);
+#else
+	// the meshes are uploaded once, after that a frame only gives the gpu their transforms.
+	UploadBatch meshUpload = beginUploadBatch(seraph.rendererContext);
+	uint32_t teapotGpuMesh = Renderer::addMesh(seraph.rendererContext, meshUpload, teapotMesh.m_vertexData, teapotMesh.m_vertexCount, teapotMesh.m_indices, teapotMesh.m_indicesCount);
+	uint32_t floorGpuMesh = Renderer::addMesh(seraph.rendererContext, meshUpload, floorMesh.m_vertexData, floorMesh.m_vertexCount, floorMesh.m_indices, floorMesh.m_indicesCount);
+	submitUploadBatch(seraph.rendererContext, meshUpload);
+	seraph.rendererContext.vk_pendingUploads.push_back(meshUpload);
+
+	Renderer::drawMesh(seraph.rendererContext, teapotGpuMesh, teapot.m_transform);
+	Renderer::drawMesh(seraph.rendererContext, floorGpuMesh, floor.m_transform, true, floorMesh.m_doubleSided);
+#endif
 
 	// = { 0, 1, 3, 0, 3, 2, 0, 2, 6, 0, 6, 4, 2, 3, 7, 6, 2, 7, 6, 7, 5, 4, 6, 5, 3, 1, 5, 3, 5, 7, 1, 0, 4, 1, 4, 5 };
 
@@ -170,10 +258,17 @@ int runEngine() {
 	double elapsedTime = 0;
 
 	int frameCount = 0;
+	ClipStats clipStats; // added up over every frame.
+	float drawnAspectRatio = 0; // the shape of the window the draws were last given for.
+#ifdef SERAPH_TIME_FRAMES
+	double runFrameMilliseconds = 0; // the cpu time of every Renderer::runFrame added up, to compare builds by one number rather than a log line per frame.
+	double slowestRunFrameMilliseconds = 0;
+#endif
 
 	while (!Renderer::frameClosed(seraph.rendererContext)) {
 		//Timer(a, "FIRST");
 		glfwPollEvents();
+		seraph.frameArena.beginFrame();
 		{
 			//Timer(b, "SECOND");
 			frameCount++;
@@ -192,17 +287,23 @@ int runEngine() {
 			float aspectRatio = (seraph.rendererContext.windowHeight + 0.0f) / seraph.rendererContext.windowWidth;
 			float fovRadians = 1.0f / tanf(seraph.rendererContext.theta * 0.5f / 180.0f * pi);
 
-			clipVertices(seraph.rendererContext.vertices, seraph.rendererContext.indices, fovRadians * aspectRatio, true, -1.0, true, false);
-			clipVertices(seraph.rendererContext.vertices, seraph.rendererContext.indices, fovRadians, true, -1.0, false, false);
-			clipVertices(seraph.rendererContext.vertices, seraph.rendererContext.indices, fovRadians * aspectRatio, false, 1.0, true, true);
-			clipVertices(seraph.rendererContext.vertices, seraph.rendererContext.indices, fovRadians, false, 1.0, false, true);
+			// what is behind the camera or past Zfar is dropped too, rather than being uploaded and divided by a z near 0 by the projection.
+			ClipPlane clipPlanes[maxClipPlanes];
+			int clipPlaneCount = frustumPlanes(fovRadians * aspectRatio, fovRadians, seraph.rendererContext.Znear, seraph.rendererContext.Zfar, clipPlanes);
 
-			if (seraph.rendererContext.vertices.size() > 0 && seraph.rendererContext.indices.size() > 0) {
-				Renderer::updateBuffer(seraph.rendererContext);
+			{
+#ifdef SERAPH_TIME_FRAMES
+				Timer(frameTime, "Renderer::runFrame");
+				auto runFrameStart = std::chrono::steady_clock::now();
+#endif
+				Renderer::runFrame(seraph.rendererContext); // also streams the vertices and indices to the gpu.
+#ifdef SERAPH_TIME_FRAMES
+				double runFrameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - runFrameStart).count();
+				runFrameMilliseconds += runFrameTime;
+				slowestRunFrameMilliseconds = std::max(slowestRunFrameMilliseconds, runFrameTime);
+#endif
 			}
 
-			Renderer::runFrame(seraph.rendererContext);
-
 			double xDynamicShift = 0, yDynamicShift = 0, zDynamicShift = 0;
 			double xWorldShift = 0, yWorldShift = 0, zWorldShift = 0;
 
@@ -342,10 +443,38 @@ int runEngine() {
 			teapot.shiftNRot(xWorldShift+xDynamicShift, yWorldShift + yDynamicShift, zWorldShift + zDynamicShift, spinAlongY, spinAlongX);
 			floor.shiftNRot(xWorldShift, yWorldShift, zWorldShift, spinAlongY, spinAlongX);
 
-			seraph.rendererContext.indices.clear();
-			seraph.rendererContext.vertices.clear();
-			teapot.addToBufferNoIndex(seraph.rendererContext.vertices, seraph.rendererContext.indices);
-			floor.addToBufferNoIndex(seraph.rendererContext.vertices, seraph.rendererContext.indices);
+#ifndef SERAPH_CPU_TRANSFORM
+			// the draws are only given again when something moved, an idle frame submits the command buffers that were recorded for it before.
+			// (or when the window changed shape, as that moves the planes the objects are culled with.)
+			if (0 != xWorldShift || 0 != yWorldShift || 0 != zWorldShift || 0 != xDynamicShift || 0 != yDynamicShift || 0 != zDynamicShift || 0 != spinAlongY || 0 != spinAlongX || aspectRatio != drawnAspectRatio) {
+				seraph.rendererContext.drawItems.clear();
+				seraph.rendererContext.instances.clear();
+				drawnAspectRatio = aspectRatio;
+
+				// an object the camera cannot see is not drawn at all, the gpu would only have thrown away each of its triangles.
+				GameObject* objects[] = { &teapot, &floor };
+				uint32_t gpuMeshes[] = { teapotGpuMesh, floorGpuMesh };
+				for (int object = 0; object < 2; object++) {
+					const Mesh& mesh = *objects[object]->mesh;
+					if (boundsOutside == classifyBounds(mesh.m_boundsMin, mesh.m_boundsMax, mesh.m_boundsCenter, mesh.m_boundsRadius, objects[object]->m_transform, clipPlanes, clipPlaneCount)) {
+						clipStats.culledObjects++;
+						continue;
+					}
+					Renderer::drawMesh(seraph.rendererContext, gpuMeshes[object], objects[object]->m_transform, true, mesh.m_doubleSided);
+				}
+				Renderer::markSceneChanged(seraph.rendererContext);
+			}
+#else
+			Renderer::markSceneChanged(seraph.rendererContext);
+			GameObject* objects[] = { &teapot, &floor };
+			ClipStats frameClipStats;
+			streamVisibleObjects(seraph.rendererContext, objects, 2, clipPlanes, clipPlaneCount, seraph.frameArena, frameClipStats);
+			clipStats.add(frameClipStats);
+
+			// the vertices are shared between triangles, so a vertex gets the average brightness of the triangles around it. The back faces are gone by now,
+			// other than those of double sided meshes, which are lit the same from either side (as shader.frag does).
+			FrameVector<float> brightnessSum(seraph.rendererContext.vertices.size(), 0.0f, FrameAllocator<float>(seraph.frameArena));
+			FrameVector<uint32_t> adjacentTriangles(seraph.rendererContext.vertices.size(), 0, FrameAllocator<uint32_t>(seraph.frameArena));
 
 			for (int index = 0; index < seraph.rendererContext.indices.size(); index+=3) {
 
@@ -381,57 +510,22 @@ int runEngine() {
 
 				//brightness *= abs(brightness);
 
-				if (abs(normal.z) > abs(normal.x) && abs(normal.z) > abs(normal.y)) {
-					seraph.rendererContext.vertices[v1Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v1Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v1Pos].color[2] = brightness;
-
-					seraph.rendererContext.vertices[v2Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v2Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v2Pos].color[2] = brightness;
-
-					seraph.rendererContext.vertices[v3Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v3Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v3Pos].color[2] = brightness;
-
-				}  if (abs(normal.y) > abs(normal.x) && abs(normal.y) > abs(normal.z)) {
-					seraph.rendererContext.vertices[v1Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v1Pos].color[1] = brightness;
-					seraph.rendererContext.vertices[v1Pos].color[2] = 0;
-
-					seraph.rendererContext.vertices[v2Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v2Pos].color[1] = brightness;
-					seraph.rendererContext.vertices[v2Pos].color[2] = 0;
-
-					seraph.rendererContext.vertices[v3Pos].color[0] = 0;
-					seraph.rendererContext.vertices[v3Pos].color[1] = brightness;
-					seraph.rendererContext.vertices[v3Pos].color[2] = 0;
-
-				} if (abs(normal.x) > abs(normal.y) && abs(normal.x) > abs(normal.z)) {
-					seraph.rendererContext.vertices[v1Pos].color[0] = brightness;
-					seraph.rendererContext.vertices[v1Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v1Pos].color[2] = 0;
-
-					seraph.rendererContext.vertices[v2Pos].color[0] = brightness;
-					seraph.rendererContext.vertices[v2Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v2Pos].color[2] = 0;
-
-					seraph.rendererContext.vertices[v3Pos].color[0] = brightness;
-					seraph.rendererContext.vertices[v3Pos].color[1] = 0;
-					seraph.rendererContext.vertices[v3Pos].color[2] = 0;
-				}
-				seraph.rendererContext.vertices[v1Pos].color[0] = brightness;
-				seraph.rendererContext.vertices[v1Pos].color[1] = brightness;
-				seraph.rendererContext.vertices[v1Pos].color[2] = brightness;
-
-				seraph.rendererContext.vertices[v2Pos].color[0] = brightness;
-				seraph.rendererContext.vertices[v2Pos].color[1] = brightness;
-				seraph.rendererContext.vertices[v2Pos].color[2] = brightness;
+				brightness = fabsf(brightness);
+				brightnessSum[v1Pos] += brightness;
+				brightnessSum[v2Pos] += brightness;
+				brightnessSum[v3Pos] += brightness;
+				adjacentTriangles[v1Pos]++;
+				adjacentTriangles[v2Pos]++;
+				adjacentTriangles[v3Pos]++;
+			}
 
-				seraph.rendererContext.vertices[v3Pos].color[0] = brightness;
-				seraph.rendererContext.vertices[v3Pos].color[1] = brightness;
-				seraph.rendererContext.vertices[v3Pos].color[2] = brightness;
+			for (size_t index = 0; index < seraph.rendererContext.vertices.size(); index++) {
+				float brightness = adjacentTriangles[index] ? brightnessSum[index] / adjacentTriangles[index] : 0;
+				seraph.rendererContext.vertices[index].color[0] = brightness;
+				seraph.rendererContext.vertices[index].color[1] = brightness;
+				seraph.rendererContext.vertices[index].color[2] = brightness;
 			}
+#endif
 
 			lastX = newX;
 			lastY = newY;
@@ -440,6 +534,19 @@ int runEngine() {
 
 	std::cout << elapsedTime / frameCount << "time per frame";
 
+#ifdef SERAPH_TIME_FRAMES
+	logRecord("Renderer::runFrame took " + std::to_string(runFrameMilliseconds / std::max(frameCount, 1)) + "ms of cpu time on average over " + std::to_string(frameCount)
+		+ " frames, " + std::to_string(slowestRunFrameMilliseconds) + "ms at most.", logLevelInfo);
+#endif
+
+	std::string culled = "Triangles culled by the clip stage over " + std::to_string(frameCount) + " frames:";
+	for (int plane = 0; plane < 6; plane++) {
+		culled += " " + std::string(frustumPlaneNames[plane]) + " " + std::to_string(clipStats.culledByPlane[plane]);
+	}
+	culled += ", objects culled whole " + std::to_string(clipStats.culledObjects) + ", objects not clipped " + std::to_string(clipStats.unclippedObjects)
+		+ ", back faces " + std::to_string(clipStats.backFaceTriangles);
+	logRecord(culled, logLevelInfo);
+
 	//_ renContext.m_vertices[0].pos[0] = tempVarForVertex;
 	tempVarForVertex += shift * 0.001;
 	if (tempVarForVertex > 0.75) { shift *= -1; }
@@ -449,297 +556,3 @@ int runEngine() {
 
 	return 0;
 }
-
-void clipVertices(std::vector<Vertex>& verts, std::vector<uint16_t>& indices, float scaleLeft, bool compareLessThan, float scaleRight, bool xUsed, bool flip) {
-
-	std::vector<Vertex> vecData;
-	std::vector<uint16_t> indexData;
-
-	int oobCount = 0; // out of bounds count
-	// compare left x
-	for (int index = 0; index < indices.size(); index += 3) {
-		bool first = false, second = false, third = false;
-		
-		if (xUsed) {
-			if (compareLessThan) {
-				first = verts[indices[index]].pos.x * scaleLeft < scaleRight * verts[indices[index]].pos.z;
-				second = verts[indices[index + 1]].pos.x * scaleLeft < scaleRight * verts[indices[index + 1]].pos.z;
-				third = verts[indices[index + 2]].pos.x * scaleLeft < scaleRight * verts[indices[index + 2]].pos.z;
-			}
-			else {
-				first = verts[indices[index]].pos.x * scaleLeft > scaleRight * verts[indices[index]].pos.z;
-				second = verts[indices[index + 1]].pos.x * scaleLeft > scaleRight * verts[indices[index + 1]].pos.z;
-				third = verts[indices[index + 2]].pos.x * scaleLeft > scaleRight * verts[indices[index + 2]].pos.z;
-			}
-		} else {
-			if (compareLessThan) {
-				first = verts[indices[index]].pos.y * scaleLeft < scaleRight * verts[indices[index]].pos.z;
-				second = verts[indices[index + 1]].pos.y * scaleLeft < scaleRight * verts[indices[index + 1]].pos.z;
-				third = verts[indices[index + 2]].pos.y * scaleLeft < scaleRight * verts[indices[index + 2]].pos.z;
-			}
-			else {
-				first = verts[indices[index]].pos.y * scaleLeft > scaleRight * verts[indices[index]].pos.z;
-				second = verts[indices[index + 1]].pos.y * scaleLeft > scaleRight * verts[indices[index + 1]].pos.z;
-				third = verts[indices[index + 2]].pos.y * scaleLeft > scaleRight * verts[indices[index + 2]].pos.z;
-			}
-		}
-
-		oobCount = 0;
-
-		if (first) {
-			oobCount++;
-		}
-		if (second) {
-			oobCount++;
-		}
-		if (third) {
-			oobCount++;
-		}
-
-		int size = vecData.size();
-
-		//std::cout << oobCount << " " << first << second << third <<  "\r";
-
-		Vertex p1 = verts[indices[index]];
-		Vec3 v1 = verts[indices[index]].pos;
-		Vertex p2 = verts[indices[index + 1]];
-		Vec3 v2 = verts[indices[index + 1]].pos;
-		Vertex p3 = verts[indices[index + 2]];
-		Vec3 v3 = verts[indices[index + 2]].pos;
-
-		Vec3 normal;
-		if (!flip) {
-			if (xUsed) {
-				normal = { scaleLeft, 0, 1 };
-			}
-			else {
-				normal = { 0, scaleLeft, 1 };
-			}
-		} else {
-			if (xUsed) {
-				normal = { -scaleLeft, 0, 1 };
-			}
-			else {
-				normal = { 0, -scaleLeft, 1 };
-			}
-		}
-
-		switch (oobCount) {
-		case 0:
-			vecData.push_back(p1);
-			vecData.push_back(p2);
-			vecData.push_back(p3);
-			indexData.push_back(size);
-			indexData.push_back(size + 1);
-			indexData.push_back(size + 2);
-			break;
-		case 1:
-			if (first) {
-				Vec3 V1to2 = v2 - v1;
-				Vec3 V1to3 = v3 - v1;
-
-				float dot1to2 = Vec3::dot(V1to2, normal);
-				float dot1to3 = Vec3::dot(V1to3, normal);
-
-				Vec3 w = v1 - Vec3{ 0, 0, 0 };
-				float fac1to2 = -Vec3::dot(normal, w) / dot1to2;
-				float fac1to3 = -Vec3::dot(normal, w) / dot1to3;
-
-				V1to2 = fac1to2 * V1to2;
-				V1to3 = fac1to3 * V1to3;
-
-				Vec3 poi1n2 = v1 + V1to2;
-				Vec3 poi1n3 = v1 + V1to3;
-
-				Vertex V4 = p1;
-				Vertex V5 = p1;
-
-				V4.pos = poi1n2;
-				V5.pos = poi1n3;
-
-				vecData.push_back(V4);
-				vecData.push_back(V5);
-				vecData.push_back(verts[ indices[index + 1]]);
-				vecData.push_back(verts[ indices[index + 2]]);
-				indexData.push_back(size);
-				indexData.push_back(size + 2);
-				indexData.push_back(size + 3);
-				indexData.push_back(size);
-				indexData.push_back(size + 3);
-				indexData.push_back(size + 1);
-			}
-			else if (second) {
-				Vec3 V2to1 = v1 - v2;
-				Vec3 V2to3 = v3 - v2;
-
-				float dot2to1 = Vec3::dot(V2to1, normal);
-				float dot2to3 = Vec3::dot(V2to3, normal);
-
-				Vec3 w = v2 - Vec3{ 0, 0, 0 };
-				float fac2to1 = -Vec3::dot(normal, w) / dot2to1;
-				float fac2to3 = -Vec3::dot(normal, w) / dot2to3;
-
-				V2to1 = fac2to1 * V2to1;
-				V2to3 = fac2to3 * V2to3;
-
-				Vec3 poi2n1 = v2 + V2to1;
-				Vec3 poi2n3 = v2 + V2to3;
-
-				Vertex V4 = p2;
-				Vertex V5 = p2;
-
-				V4.pos = poi2n1;
-				V5.pos = poi2n3;
-
-				vecData.push_back(verts[indices[index]]);
-				vecData.push_back(V4);
-				vecData.push_back(V5);
-				vecData.push_back(verts[indices[index + 2]]);
-				indexData.push_back(size);
-				indexData.push_back(size + 1);
-				indexData.push_back(size + 2);
-				indexData.push_back(size);
-				indexData.push_back(size + 2);
-				indexData.push_back(size + 3);
-			}
-			else if (third) {
-
-				Vec3 V3to1 = v1 - v3;
-				Vec3 V3to2 = v2 - v3;
-
-				float dot3to1 = Vec3::dot(V3to1, normal);
-				float dot3to2 = Vec3::dot(V3to2, normal);
-
-				Vec3 w = v3 - Vec3{ 0, 0, 0 };
-				float fac3to1 = -Vec3::dot(normal, w) / dot3to1;
-				float fac3to2 = -Vec3::dot(normal, w) / dot3to2;
-
-				V3to1 = fac3to1 * V3to1;
-				V3to2 = fac3to2 * V3to2;
-
-				Vec3 poi3n1 = v3 + V3to1;
-				Vec3 poi3n2 = v3 + V3to2;
-
-				Vertex V4 = p3;
-				Vertex V5 = p3;
-
-				V4.pos = poi3n1;
-				V5.pos = poi3n2;
-
-				vecData.push_back(verts[indices[index]]);
-				vecData.push_back(verts[indices[index + 1]]);
-				vecData.push_back(V4);
-				vecData.push_back(V5);
-				indexData.push_back(size);
-				indexData.push_back(size + 1);
-				indexData.push_back(size + 3);
-				indexData.push_back(size);
-				indexData.push_back(size + 3);
-				indexData.push_back(size + 2);
-			}
-			break;
-		case 2:
-			if (first && second) {
-				Vec3 V3to1 = v1 - v3;
-				Vec3 V3to2 = v2 - v3;
-
-				float dot3to1 = Vec3::dot(V3to1, normal);
-				float dot3to2 = Vec3::dot(V3to2, normal);
-
-				Vec3 w = v3 - Vec3{ 0, 0, 0 };
-				float fac3to1 = -Vec3::dot(normal, w) / dot3to1;
-				float fac3to2 = -Vec3::dot(normal, w) / dot3to2;
-
-				V3to1 = fac3to1 * V3to1;
-				V3to2 = fac3to2 * V3to2;
-
-				Vec3 poi3n1 = v3 + V3to1;
-				Vec3 poi3n2 = v3 + V3to2;
-
-				Vertex V4=p3;
-				Vertex V5=p3;
-
-				V4.pos = poi3n1;
-				V5.pos = poi3n2;
-
-				vecData.push_back(V4);
-				vecData.push_back(V5);
-				vecData.push_back(verts[indices[index + 2]]);
-				indexData.push_back(size);
-				indexData.push_back(size + 1);
-				indexData.push_back(size + 2);
-
-			}
-			else if (first && third) {
-				Vec3 V2to1 = v1 - v2;
-				Vec3 V2to3 = v3 - v2;
-
-				float dot2to1 = Vec3::dot(V2to1, normal);
-				float dot2to3 = Vec3::dot(V2to3, normal);
-
-				Vec3 w = v2 - Vec3{ 0, 0, 0 };
-				float fac2to1 = -Vec3::dot(normal, w) / dot2to1;
-				float fac2to3 = -Vec3::dot(normal, w) / dot2to3;
-
-				V2to1 = fac2to1 * V2to1;
-				V2to3 = fac2to3 * V2to3;
-
-				Vec3 poi2n1 = v2 + V2to1;
-				Vec3 poi2n3 = v2 + V2to3;
-
-				Vertex V4 = p2;
-				Vertex V5 = p2;
-
-				V4.pos = poi2n1;
-				V5.pos = poi2n3;
-
-				vecData.push_back(V4);
-				vecData.push_back(verts[indices[index + 1]]);
-				vecData.push_back(V5);
-				indexData.push_back(size);
-				indexData.push_back(size + 1);
-				indexData.push_back(size + 2);
-			}
-			else if (second && third) {
-				Vec3 V1to2 = v2 - v1;
-				Vec3 V1to3 = v3 - v1;
-
-				float dot1to2 = Vec3::dot(V1to2, normal);
-				float dot1to3 = Vec3::dot(V1to3, normal);
-
-				Vec3 w = v1 - Vec3{ 0, 0, 0 };
-				float fac1to2 = -Vec3::dot(normal, w) / dot1to2;
-				float fac1to3 = -Vec3::dot(normal, w) / dot1to3;
-
-				V1to2 = fac1to2 * V1to2;
-				V1to3 = fac1to3 * V1to3;
-
-				Vec3 poi1n2 = v1 + V1to2;
-				Vec3 poi1n3 = v1 + V1to3;
-
-				Vertex V4 = p1;
-				Vertex V5 = p1;
-
-				V4.pos = poi1n2;
-				V5.pos = poi1n3;
-
-				vecData.push_back(verts[indices[index]]);
-				vecData.push_back(V4);
-				vecData.push_back(V5);
-				indexData.push_back(size);
-				indexData.push_back(size + 1);
-				indexData.push_back(size + 2);
-			}
-		case 3:
-			break;
-		default:
-			break;
-		}
-	}
-
-	 verts.clear();
-	 indices.clear();
-
-	 verts = std::move(vecData);
-	 indices = std::move(indexData);
-}
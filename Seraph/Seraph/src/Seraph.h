@@ -2,11 +2,16 @@
 #include "Renderer/Renderer.h"
 #include "Engine/Entity/Entity.h"
 #include "Engine/MemoryArena/MemoryArena.h"
+#include "Engine/MemoryArena/FrameArena.h"
+#include "Engine/MemoryArena/ObjectPool.h"
 #include "GameDetails.h"
 
 struct Seraph {
     Renderer::Context rendererContext;
     MemoryArena memoryArena;
+    ObjectPool<Player> players{ 16 };
+    ObjectPool<Ball> balls{ 1 << 16 };
+    FrameArena frameArena{ 4 << 20, MAX_FRAMES_IN_FLIGHT }; // scratch memory that is thrown away every frame (one buffer per frame in flight), 4 mb fits the clipping of the teapot scene.
 
     Seraph() {}
 